@@ -0,0 +1,327 @@
+#pragma once
+
+// Smoothed aggregation algebraic multigrid, used as a preconditioner for
+// Eigen::ConjugateGradient on the SPD systems coming from mesh laplacians.
+// Memory grows linearly with the number of unknowns, unlike the fill-in of a
+// direct factorization.
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+class AMGPreconditioner {
+public:
+    typedef double Scalar;
+    typedef Eigen::SparseMatrix<double> SpMat;
+    typedef Eigen::VectorXd Vector;
+    typedef SpMat::StorageIndex StorageIndex;
+    enum { ColsAtCompileTime = Eigen::Dynamic, MaxColsAtCompileTime = Eigen::Dynamic };
+
+    // coarsening stops once a level has fewer unknowns than this
+    int coarse_size = 400;
+    int max_levels = 20;
+    // strength of connection threshold
+    double theta = 0.08;
+
+    AMGPreconditioner() : initialized(false) {}
+
+    template<typename MatType>
+    explicit AMGPreconditioner(const MatType &mat) : initialized(false) { compute(mat); }
+
+    Eigen::Index rows() const { return levels.empty() ? 0 : levels[0].A.rows(); }
+    Eigen::Index cols() const { return rows(); }
+
+    // forgets the aggregates: the next factorize aggregates again
+    template<typename MatType>
+    AMGPreconditioner &analyzePattern(const MatType &)
+    {
+        aggregates.clear();
+        num_aggregates_.clear();
+        return *this;
+    }
+
+    // the aggregates of the first factorize after analyzePattern are kept,
+    // so a matrix with the same pattern and new values only recomputes the
+    // smoothed prolongations, the coarse operators and the coarse solve
+    template<typename MatType>
+    AMGPreconditioner &factorize(const MatType &mat)
+    {
+        build(SpMat(mat));
+        return *this;
+    }
+
+    template<typename MatType>
+    AMGPreconditioner &compute(const MatType &mat)
+    {
+        analyzePattern(mat);
+        return factorize(mat);
+    }
+
+    // one symmetric V-cycle, so the preconditioner stays valid for CG
+    template<typename Rhs>
+    Vector solve(const Eigen::MatrixBase<Rhs> &b) const
+    {
+        Vector x = Vector::Zero(b.rows());
+        vcycle(0, b, x);
+        return x;
+    }
+
+    Eigen::ComputationInfo info() { return initialized ? Eigen::Success : Eigen::NumericalIssue; }
+
+    int num_levels() const { return levels.size(); }
+
+private:
+    struct Level {
+        SpMat A;        // operator at this level (symmetric, column major)
+        SpMat P;        // prolongation to this level from the next one
+        SpMat R;        // restriction, P^T
+        Vector inv_diag;
+    };
+
+    void build(SpMat A)
+    {
+        if (!aggregates.empty() && aggregates[0].size() != (std::size_t)A.rows()) {
+            aggregates.clear();
+            num_aggregates_.clear();
+        }
+        const bool reuse = !aggregates.empty();
+        levels.clear();
+        if (!reuse) coarse.reset();
+        A.makeCompressed();
+
+        while (true) {
+            Level level;
+            level.A = A;
+            level.inv_diag = A.diagonal().cwiseInverse();
+
+            if (A.rows() <= coarse_size || (int)levels.size() + 1 >= max_levels) {
+                levels.push_back(level);
+                break;
+            }
+
+            const std::size_t l = levels.size();
+            if (!reuse) {
+                aggregates.emplace_back();
+                num_aggregates_.push_back(aggregate_nodes(A, aggregates.back()));
+            } else if (l >= aggregates.size()) {
+                levels.push_back(level);
+                break;
+            }
+            const std::vector<int> &aggregate = aggregates[l];
+            const int num_aggregates = num_aggregates_[l];
+            // no coarsening possible anymore
+            if (num_aggregates == 0 || num_aggregates >= A.rows()) {
+                levels.push_back(level);
+                break;
+            }
+
+            level.P = smoothed_prolongation(A, level.inv_diag, aggregate, num_aggregates);
+            level.R = level.P.transpose();
+            A = SpMat(level.R * A * level.P);
+            A.makeCompressed();
+            levels.push_back(level);
+        }
+
+        // same aggregates, same coarse pattern: the symbolic analysis is kept
+        if (!reuse || !coarse || levels.back().A.nonZeros() != coarse_nonzeros) {
+            coarse.reset(new Eigen::SimplicialLDLT<SpMat>());
+            coarse->analyzePattern(levels.back().A);
+            coarse_nonzeros = levels.back().A.nonZeros();
+        }
+        coarse->factorize(levels.back().A);
+        initialized = coarse->info() == Eigen::Success;
+    }
+
+    // standard three pass aggregation on the strength graph
+    int aggregate_nodes(const SpMat &A, std::vector<int> &aggregate) const
+    {
+        const int n = A.rows();
+        Vector diag = A.diagonal().cwiseAbs();
+        std::vector<std::vector<int>> strong(n);
+        for (int k = 0; k < A.outerSize(); k++) {
+            for (SpMat::InnerIterator it(A, k); it; ++it) {
+                int i = it.row(), j = it.col();
+                if (i != j && std::abs(it.value()) >= theta * std::sqrt(diag(i) * diag(j))) {
+                    strong[i].push_back(j);
+                }
+            }
+        }
+
+        aggregate.assign(n, -1);
+        int count = 0;
+
+        // pass 1: seed aggregates from nodes whose whole neighborhood is free
+        for (int i = 0; i < n; i++) {
+            if (aggregate[i] != -1) continue;
+            bool free = true;
+            for (int j : strong[i]) free = free && aggregate[j] == -1;
+            if (!free) continue;
+            aggregate[i] = count;
+            for (int j : strong[i]) aggregate[j] = count;
+            count++;
+        }
+
+        // pass 2: attach leftovers to a neighboring aggregate
+        std::vector<int> pass1 = aggregate;
+        for (int i = 0; i < n; i++) {
+            if (aggregate[i] != -1) continue;
+            for (int j : strong[i]) {
+                if (pass1[j] != -1) { aggregate[i] = pass1[j]; break; }
+            }
+        }
+
+        // pass 3: whatever is left becomes its own aggregate
+        for (int i = 0; i < n; i++) {
+            if (aggregate[i] != -1) continue;
+            aggregate[i] = count;
+            for (int j : strong[i]) {
+                if (aggregate[j] == -1) aggregate[j] = count;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    // P = (I - w D^-1 A) P_tent, with P_tent the normalized piecewise constant interpolation
+    SpMat smoothed_prolongation(const SpMat &A, const Vector &inv_diag,
+                                const std::vector<int> &aggregate, int num_aggregates) const
+    {
+        const int n = A.rows();
+        std::vector<int> size(num_aggregates, 0);
+        for (int i = 0; i < n; i++) size[aggregate[i]]++;
+
+        std::vector<Eigen::Triplet<double>> triplets;
+        triplets.reserve(n);
+        for (int i = 0; i < n; i++) {
+            triplets.emplace_back(i, aggregate[i], 1.0 / std::sqrt((double)size[aggregate[i]]));
+        }
+        SpMat T(n, num_aggregates);
+        T.setFromTriplets(triplets.begin(), triplets.end());
+
+        double omega = 4.0 / 3.0 / spectral_radius(A, inv_diag);
+        SpMat S = inv_diag.asDiagonal() * A;
+        SpMat P = T - omega * (S * T);
+        P.prune(0.0);
+        return P;
+    }
+
+    // estimate of rho(D^-1 A) by power iteration
+    static double spectral_radius(const SpMat &A, const Vector &inv_diag)
+    {
+        Vector x = Vector::LinSpaced(A.rows(), 1.0, 2.0);
+        double rho = 1.0;
+        for (int it = 0; it < 15; it++) {
+            Vector y = inv_diag.cwiseProduct(A * x);
+            double norm = y.norm();
+            if (norm == 0.0) break;
+            rho = norm / x.norm();
+            x = y / norm;
+        }
+        return std::max(rho, 1e-12);
+    }
+
+    // gauss-seidel sweep; A is symmetric so column k is row k
+    static void gauss_seidel(const Level &level, const Vector &b, Vector &x, bool forward)
+    {
+        const SpMat &A = level.A;
+        const int n = A.rows();
+        for (int s = 0; s < n; s++) {
+            int k = forward ? s : n - 1 - s;
+            double sum = b(k);
+            for (SpMat::InnerIterator it(A, k); it; ++it) {
+                if (it.row() != k) sum -= it.value() * x(it.row());
+            }
+            x(k) = sum * level.inv_diag(k);
+        }
+    }
+
+    template<typename Rhs>
+    void vcycle(std::size_t l, const Rhs &b, Vector &x) const
+    {
+        const Level &level = levels[l];
+        if (l + 1 == levels.size()) {
+            x = coarse->solve(Vector(b));
+            return;
+        }
+        Vector rhs = b;
+        gauss_seidel(level, rhs, x, true);
+        Vector r = rhs - level.A * x;
+        Vector rc = level.R * r;
+        Vector ec = Vector::Zero(rc.rows());
+        vcycle(l + 1, rc, ec);
+        x += level.P * ec;
+        gauss_seidel(level, rhs, x, false);
+    }
+
+    bool initialized;
+    std::vector<Level> levels;
+    std::vector<std::vector<int>> aggregates;   // per level, kept across factorize
+    std::vector<int> num_aggregates_;
+    std::shared_ptr<Eigen::SimplicialLDLT<SpMat>> coarse;
+    Eigen::Index coarse_nonzeros = 0;
+};
+
+
+// Solves the Dirichlet problem L W = 0 on the interior, W(b,:) = bc, with a
+// laplacian L as built by MeshOperators. Same contract as igl::harmonic with
+// k = 1, but solved by AMG preconditioned conjugate gradient.
+inline bool harmonic_amg(const Eigen::SparseMatrix<double> &L,
+                         const Eigen::VectorXi &b,
+                         const Eigen::MatrixXd &bc,
+                         Eigen::MatrixXd &W,
+                         double tolerance = 1e-10)
+{
+    typedef Eigen::SparseMatrix<double> SpMat;
+    const int n = L.rows();
+
+    // interior unknowns get consecutive indices, fixed ones -1
+    std::vector<int> index(n, 0);
+    for (int i = 0; i < b.size(); i++) index[b(i)] = -1;
+    int num_free = 0;
+    for (int i = 0; i < n; i++) {
+        if (index[i] != -1) index[i] = num_free++;
+    }
+    std::vector<int> fixed_row(n, -1);
+    for (int i = 0; i < b.size(); i++) fixed_row[b(i)] = i;
+
+    // -L_II x = L_IB bc
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(L.nonZeros());
+    Eigen::MatrixXd rhs = Eigen::MatrixXd::Zero(num_free, bc.cols());
+    for (int k = 0; k < L.outerSize(); k++) {
+        for (SpMat::InnerIterator it(L, k); it; ++it) {
+            int i = index[it.row()], j = index[it.col()];
+            if (i == -1) continue;
+            if (j != -1) triplets.emplace_back(i, j, -it.value());
+            else rhs.row(i) += it.value() * bc.row(fixed_row[it.col()]);
+        }
+    }
+    SpMat A(num_free, num_free);
+    A.setFromTriplets(triplets.begin(), triplets.end());
+
+    Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, AMGPreconditioner> cg;
+    cg.setTolerance(tolerance);
+    cg.setMaxIterations(500);
+    cg.compute(A);
+
+    Eigen::MatrixXd X(num_free, bc.cols());
+    bool ok = cg.info() == Eigen::Success;
+    for (int c = 0; c < bc.cols(); c++) {
+        X.col(c) = cg.solve(rhs.col(c));
+        ok = ok && cg.info() == Eigen::Success;
+    }
+
+    W.resize(n, bc.cols());
+    for (int i = 0; i < n; i++) {
+        if (index[i] != -1) W.row(i) = X.row(index[i]);
+        else W.row(i) = bc.row(fixed_row[i]);
+    }
+    return ok;
+}
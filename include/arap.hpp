@@ -0,0 +1,127 @@
+#pragma once
+
+// Local/global ARAP parametrization (Liu et al. 2008) on arrays:
+//   local:  the rotation closest to the jacobian of every face; for a 2x2
+//           matrix it is the normalized (J00 + J11, J10 - J01), so the step
+//           is a branch free loop over faces that vectorizes;
+//   global: the uv minimizing sum_f area_f |J_f - R_f|^2, a cotangent
+//           laplacian system factorized once (one vertex pinned for the
+//           translation) and reused by every iteration.
+// Iterations stop when the energy decreases by less than `tolerance`
+// (relative). ARAP does not guarantee an injective map; callers count the
+// flips of the result.
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "mesh_operators.hpp"
+#include "trace.hpp"
+
+
+struct ArapResult {
+    int iterations = 0;
+    double energy = 0.0;    // sum_f area_f |J_f - R_f|^2 / sum_f area_f
+    bool converged = false;
+};
+
+// uv: initial map on input (e.g. Tutte), result on output, V.rows() x 2
+inline ArapResult arap_parametrize(MeshOperators &ops, const Eigen::Ref<const Eigen::MatrixXi> &F, Eigen::MatrixXd &uv,
+                                   int max_iterations = 100, double tolerance = 1e-6)
+{
+    typedef Eigen::SparseMatrix<double> SpMat;
+    TRACE_SCOPE("arap");
+    const int n = ops.num_vertices;
+    const int nf = F.rows();
+    const Eigen::VectorXd &area = ops.area;
+    const FaceGradients &grad = ops.grad;
+    const double total_area = area.sum();
+    ArapResult result;
+
+    // K = -L is positive semi-definite with the constants as null space;
+    // vertex 0 is pinned and its column moves to the right hand side
+    const int pinned = 0;
+    std::vector<int> index(n);
+    for (int i = 0; i < n; i++) index[i] = i < pinned ? i : i - 1;
+    index[pinned] = -1;
+    SpMat K(n - 1, n - 1);
+    Eigen::VectorXd K_pinned = Eigen::VectorXd::Zero(n);
+    {
+        TRACE_SCOPE("arap_factorize");
+        const SpMat &L = ops.cotangent_laplacian();
+        std::vector<Eigen::Triplet<double>> triplets;
+        triplets.reserve(L.nonZeros());
+        for (int k = 0; k < L.outerSize(); k++) {
+            for (SpMat::InnerIterator it(L, k); it; ++it) {
+                if (it.col() == pinned) {
+                    K_pinned(it.row()) = -it.value();
+                } else if (index[it.row()] >= 0) {
+                    triplets.emplace_back(index[it.row()], index[it.col()], -it.value());
+                }
+            }
+        }
+        K.setFromTriplets(triplets.begin(), triplets.end());
+    }
+    Eigen::SimplicialLDLT<SpMat> solver(K);
+    if (solver.info() != Eigen::Success) {
+        std::cerr << "Error! ARAP factorization failed" << std::endl;
+        return result;
+    }
+
+    // rotation per face: R = [c -s; s c]
+    Eigen::VectorXd c(nf), s(nf), residual(nf);
+    Eigen::MatrixXd rhs(n, 2);
+    double previous = 0.0;
+    for (int it = 0; it <= max_iterations; it++) {
+        // local step, and the energy of the current uv
+        #pragma omp parallel for simd
+        for (int f = 0; f < nf; f++) {
+            const int a = F(f, 0), b = F(f, 1), d = F(f, 2);
+            double j00 = uv(a, 0) * grad(f, 0) + uv(b, 0) * grad(f, 1) + uv(d, 0) * grad(f, 2);
+            double j01 = uv(a, 0) * grad(f, 3) + uv(b, 0) * grad(f, 4) + uv(d, 0) * grad(f, 5);
+            double j10 = uv(a, 1) * grad(f, 0) + uv(b, 1) * grad(f, 1) + uv(d, 1) * grad(f, 2);
+            double j11 = uv(a, 1) * grad(f, 3) + uv(b, 1) * grad(f, 4) + uv(d, 1) * grad(f, 5);
+            double cf = j00 + j11, sf = j10 - j01;
+            double norm = std::sqrt(cf * cf + sf * sf);
+            cf = norm > 0.0 ? cf / norm : 1.0;
+            sf = norm > 0.0 ? sf / norm : 0.0;
+            c(f) = cf;
+            s(f) = sf;
+            residual(f) = area(f) * ((j00 - cf) * (j00 - cf) + (j01 + sf) * (j01 + sf) +
+                                     (j10 - sf) * (j10 - sf) + (j11 - cf) * (j11 - cf));
+        }
+        result.energy = residual.sum() / total_area;
+        if (it > 0 && previous - result.energy <= tolerance * previous) {
+            result.converged = true;
+            break;
+        }
+        if (it == max_iterations) break;
+        previous = result.energy;
+        result.iterations = it + 1;
+
+        // global step: rhs_i = sum_f area_f R_f grad_i
+        rhs.setZero();
+        for (int f = 0; f < nf; f++) {
+            for (int i = 0; i < 3; i++) {
+                double gx = grad(f, i), gy = grad(f, 3 + i);
+                rhs(F(f, i), 0) += area(f) * (c(f) * gx - s(f) * gy);
+                rhs(F(f, i), 1) += area(f) * (s(f) * gx + c(f) * gy);
+            }
+        }
+        for (int k = 0; k < 2; k++) {
+            Eigen::VectorXd b(n - 1);
+            for (int i = 0; i < n; i++) {
+                if (index[i] >= 0) b(index[i]) = rhs(i, k) - K_pinned(i) * uv(pinned, k);
+            }
+            Eigen::VectorXd x = solver.solve(b);
+            for (int i = 0; i < n; i++) {
+                if (index[i] >= 0) uv(i, k) = x(index[i]);
+            }
+        }
+    }
+    return result;
+}
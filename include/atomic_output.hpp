@@ -0,0 +1,56 @@
+#pragma once
+
+// Outputs are written to a temporary file next to their destination and
+// renamed over it once complete, so a killed process never leaves a partial
+// file behind and concurrent readers (batch workers, the result cache) only
+// ever see complete outputs. The caller reports whether all its writes
+// succeeded; a failed write is never published.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+
+class AtomicOutput {
+public:
+    explicit AtomicOutput(const std::string &path)
+        : path(path), tmp(path + ".tmp." + std::to_string(getpid()))
+    {
+    }
+
+    // tmp must be on the same filesystem as path, e.g. in the same directory
+    AtomicOutput(const std::string &path, const std::string &tmp) : path(path), tmp(tmp) {}
+
+    ~AtomicOutput()
+    {
+        if (!committed) remove(tmp.c_str());
+    }
+
+    // where to write
+    const std::string &temp_path() const { return tmp; }
+
+    // publishes the complete file under its final name if `written` (all
+    // writes, flush and close of the caller succeeded), removes it otherwise
+    bool commit(bool written)
+    {
+        committed = written && rename(tmp.c_str(), path.c_str()) == 0;
+        if (!committed) {
+            fprintf(stderr, "IOError: %s could not be written\n", path.c_str());
+            remove(tmp.c_str());
+        }
+        return committed;
+    }
+
+    // fclose for a stream written to temp_path(): false if a write failed
+    static bool close(FILE *file)
+    {
+        bool ok = fflush(file) == 0 && !ferror(file);
+        return (fclose(file) == 0) && ok;
+    }
+
+private:
+    std::string path;
+    std::string tmp;
+    bool committed = false;
+};
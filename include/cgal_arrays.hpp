@@ -0,0 +1,76 @@
+#pragma once
+
+// Conversion of CGAL face graphs (Surface_mesh, Polyhedron_3, ...) to the
+// V/F matrices used by the shared array based code (validation, metrics).
+
+#include <Eigen/Core>
+
+#include <boost/graph/graph_traits.hpp>
+#include <boost/unordered_map.hpp>
+#include <CGAL/boost/graph/helpers.h>
+#include <CGAL/boost/graph/iterator.h>
+
+#include <cstdlib>
+#include <string>
+
+#include "mesh_validation.hpp"
+
+
+// vertex and face rows follow the iteration order of vertices(mesh), faces(mesh);
+// non triangular faces become rows of -1 so that validation rejects them
+template <class FaceGraph>
+void mesh_to_arrays(const FaceGraph &mesh, Eigen::MatrixXd &V, Eigen::MatrixXi &F)
+{
+    typedef typename boost::graph_traits<FaceGraph>::vertex_descriptor vertex_descriptor;
+    typedef typename boost::graph_traits<FaceGraph>::face_descriptor   face_descriptor;
+
+    boost::unordered_map<vertex_descriptor, int> index;
+    index.reserve(num_vertices(mesh));
+    auto vpm = get(CGAL::vertex_point, mesh);
+
+    V.resize(num_vertices(mesh), 3);
+    int nv = 0;
+    for (vertex_descriptor vd : vertices(mesh)) {
+        const auto &p = get(vpm, vd);
+        V.row(nv) << p.x(), p.y(), p.z();
+        index[vd] = nv++;
+    }
+    V.conservativeResize(nv, 3);
+
+    F.resize(num_faces(mesh), 3);
+    int nf = 0;
+    for (face_descriptor fd : faces(mesh)) {
+        F.row(nf).setConstant(-1);
+        int corner = 0;
+        for (vertex_descriptor vd : vertices_around_face(halfedge(fd, mesh), mesh)) {
+            if (corner < 3) F(nf, corner) = index[vd];
+            corner++;
+        }
+        if (corner != 3) F.row(nf).setConstant(-1);
+        nf++;
+    }
+    F.conservativeResize(nf, 3);
+}
+
+// rebuilds a Surface_mesh from arrays, vertex i and face f keep their row index
+template <class SurfaceMesh>
+void arrays_to_mesh(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F, SurfaceMesh &mesh)
+{
+    typedef typename SurfaceMesh::Point Point;
+    typedef typename SurfaceMesh::Vertex_index Vertex_index;
+
+    mesh.clear();
+    mesh.reserve(V.rows(), 3 * F.rows() / 2 + V.rows(), F.rows());
+    for (int v = 0; v < V.rows(); v++) mesh.add_vertex(Point(V(v, 0), V(v, 1), V(v, 2)));
+    for (int f = 0; f < F.rows(); f++) mesh.add_face(Vertex_index(F(f, 0)), Vertex_index(F(f, 1)), Vertex_index(F(f, 2)));
+}
+
+template <class FaceGraph>
+bool check_mesh(const FaceGraph &mesh, const MeshRequirements &requirements, const std::string &name = "Input")
+{
+    if (std::getenv("PARAM_NO_VALIDATE") != NULL) return true;
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    mesh_to_arrays(mesh, V, F);
+    return check_mesh(V, F, requirements, name);
+}
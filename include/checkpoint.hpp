@@ -0,0 +1,178 @@
+#pragma once
+
+// Binary checkpoints of the SLIM iterate, written from a background thread
+// so the solver loop only pays for copying the current uv.
+
+#include <Eigen/Core>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+
+struct SlimCheckpoint {
+    Eigen::MatrixXd V_o;        // current uv, input vertex order
+    double energy = 0.0;
+    int iteration = 0;          // completed iterations
+    int total_iterations = 0;   // iterations requested for the whole run
+    int slim_energy = 0;        // igl::MappingEnergyType
+    double soft_const_p = 0.0;
+    double exp_factor = 1.0;
+    int num_vertices = 0;       // used to reject checkpoints of another mesh
+    int num_faces = 0;
+};
+
+static const char SLIM_CHECKPOINT_MAGIC[8] = {'S', 'L', 'I', 'M', 'C', 'K', 'P', 'T'};
+// 2: V_o in the input vertex order
+static const std::uint32_t SLIM_CHECKPOINT_VERSION = 2;
+
+// writes to a temporary file and renames it, so a crash never leaves a
+// truncated checkpoint behind
+inline bool write_checkpoint(const std::string &path, const SlimCheckpoint &ckpt)
+{
+    std::string tmp = path + ".tmp";
+    FILE *out = fopen(tmp.c_str(), "wb");
+    if (out == NULL) {
+        fprintf(stderr, "IOError: %s could not be opened for writing...\n", tmp.c_str());
+        return false;
+    }
+    std::int32_t ints[6] = { ckpt.iteration, ckpt.total_iterations, ckpt.slim_energy,
+                             ckpt.num_vertices, ckpt.num_faces, 0 };
+    double doubles[3] = { ckpt.energy, ckpt.soft_const_p, ckpt.exp_factor };
+    std::int64_t shape[2] = { (std::int64_t)ckpt.V_o.rows(), (std::int64_t)ckpt.V_o.cols() };
+
+    bool ok = fwrite(SLIM_CHECKPOINT_MAGIC, 1, 8, out) == 8
+           && fwrite(&SLIM_CHECKPOINT_VERSION, sizeof(std::uint32_t), 1, out) == 1
+           && fwrite(ints, sizeof(std::int32_t), 6, out) == 6
+           && fwrite(doubles, sizeof(double), 3, out) == 3
+           && fwrite(shape, sizeof(std::int64_t), 2, out) == 2
+           && fwrite(ckpt.V_o.data(), sizeof(double), ckpt.V_o.size(), out) == (std::size_t)ckpt.V_o.size();
+    ok = (fflush(out) == 0) && ok;
+    ok = (fsync(fileno(out)) == 0) && ok;
+    ok = (fclose(out) == 0) && ok;
+
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "IOError: checkpoint %s could not be written\n", path.c_str());
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+inline bool read_checkpoint(const std::string &path, SlimCheckpoint &ckpt)
+{
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in == NULL) return false;
+
+    char magic[8];
+    std::uint32_t version = 0;
+    std::int32_t ints[6];
+    double doubles[3];
+    std::int64_t shape[2];
+    bool ok = fread(magic, 1, 8, in) == 8
+           && std::memcmp(magic, SLIM_CHECKPOINT_MAGIC, 8) == 0
+           && fread(&version, sizeof(std::uint32_t), 1, in) == 1
+           && version == SLIM_CHECKPOINT_VERSION
+           && fread(ints, sizeof(std::int32_t), 6, in) == 6
+           && fread(doubles, sizeof(double), 3, in) == 3
+           && fread(shape, sizeof(std::int64_t), 2, in) == 2
+           && shape[0] >= 0 && shape[1] >= 0;
+    if (ok) {
+        ckpt.V_o.resize(shape[0], shape[1]);
+        ok = fread(ckpt.V_o.data(), sizeof(double), ckpt.V_o.size(), in) == (std::size_t)ckpt.V_o.size();
+    }
+    fclose(in);
+    if (!ok) {
+        fprintf(stderr, "Warning: checkpoint %s is unreadable, ignoring it\n", path.c_str());
+        return false;
+    }
+
+    ckpt.iteration        = ints[0];
+    ckpt.total_iterations = ints[1];
+    ckpt.slim_energy      = ints[2];
+    ckpt.num_vertices     = ints[3];
+    ckpt.num_faces        = ints[4];
+    ckpt.energy       = doubles[0];
+    ckpt.soft_const_p = doubles[1];
+    ckpt.exp_factor   = doubles[2];
+    return true;
+}
+
+// the run completed: a checkpoint left behind would only resume a finished job
+inline void remove_slim_checkpoint(const std::string &checkpoint_path)
+{
+    remove(checkpoint_path.c_str());
+}
+
+
+// Single background writer. Only the latest submitted snapshot is kept: if the
+// disk is slower than the solver, intermediate snapshots are dropped instead
+// of stalling the solver loop.
+class AsyncCheckpointWriter {
+public:
+    explicit AsyncCheckpointWriter(const std::string &path)
+        : path(path), stop(false), worker(&AsyncCheckpointWriter::run, this) {}
+
+    ~AsyncCheckpointWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    void submit(const SlimCheckpoint &ckpt)
+    {
+        std::unique_ptr<SlimCheckpoint> snapshot(new SlimCheckpoint(ckpt));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.swap(snapshot);
+        }
+        cv.notify_one();
+    }
+
+    // blocks until the last submitted snapshot is on disk
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return !pending && !writing; });
+    }
+
+    AsyncCheckpointWriter(const AsyncCheckpointWriter &) = delete;
+    AsyncCheckpointWriter &operator=(const AsyncCheckpointWriter &) = delete;
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return stop || pending; });
+            if (!pending) break; // stop requested and nothing left to write
+            std::unique_ptr<SlimCheckpoint> snapshot;
+            snapshot.swap(pending);
+            writing = true;
+            lock.unlock();
+            write_checkpoint(path, *snapshot);
+            lock.lock();
+            writing = false;
+            idle.notify_all();
+        }
+        idle.notify_all();
+    }
+
+    std::string path;
+    std::mutex mutex;
+    std::condition_variable cv, idle;
+    std::unique_ptr<SlimCheckpoint> pending;
+    bool writing = false;
+    bool stop;
+    std::thread worker;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+// Free boundary conformal initialization in the spirit of Boundary First
+// Flattening (Sawhney and Crane 2017), with zero boundary scale factors
+// (boundary lengths are kept, which keeps the area distortion low):
+//   1. solve for the conformal scale factors u with u = 0 on the boundary;
+//      the Dirichlet-to-Neumann map gives the target boundary curvature
+//   2. integrate the curvature into a closed boundary curve, closing it with
+//      the smallest change of the edge lengths
+//   3. extend the curve harmonically to the interior
+// Steps 1 and 3 share one Cholesky factorization of the interior block of
+// the cotangent laplacian. A flipped result is rejected, and the caller falls
+// back to the circle harmonic map.
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+#include <cmath>
+#include <vector>
+
+#include "mesh_operators.hpp"
+#include "trace.hpp"
+
+
+// Writes uv and returns true on success; bnd is the boundary loop, oriented
+// like the faces (as returned by igl::boundary_loop).
+inline bool conformal_init(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                           const Eigen::VectorXi &bnd, MeshOperators &ops, Eigen::MatrixXd &uv)
+{
+    TRACE_SCOPE("conformal_init");
+    const int nv = V.rows();
+    const int nb = bnd.size();
+    if (nb < 3) return false;
+
+    // interior / boundary numbering
+    std::vector<int> index(nv, -1);
+    for (int i = 0; i < nb; i++) index[bnd(i)] = i;
+    int ni = 0;
+    std::vector<int> interior;
+    for (int v = 0; v < nv; v++) {
+        if (index[v] < 0) {
+            index[v] = ni++;
+            interior.push_back(v);
+        }
+    }
+    std::vector<char> on_boundary(nv, 0);
+    for (int i = 0; i < nb; i++) on_boundary[bnd(i)] = 1;
+
+    // angle defects: 2 pi - sum of angles inside, pi - sum of angles on the boundary
+    Eigen::VectorXd K(nv);
+    for (int v = 0; v < nv; v++) K(v) = on_boundary[v] ? M_PI : 2.0 * M_PI;
+    for (int f = 0; f < F.rows(); f++) {
+        for (int i = 0; i < 3; i++) {
+            Eigen::Vector3d a = (V.row(F(f, (i + 1) % 3)) - V.row(F(f, i))).head<3>().transpose();
+            Eigen::Vector3d b = (V.row(F(f, (i + 2) % 3)) - V.row(F(f, i))).head<3>().transpose();
+            K(F(f, i)) -= std::atan2(a.cross(b).norm(), a.dot(b));
+        }
+    }
+
+    // A = -L is positive semi-definite; split into interior / boundary blocks
+    const Eigen::SparseMatrix<double> &L = ops.cotangent_laplacian();
+    std::vector<Eigen::Triplet<double>> t_ii, t_ib, t_bi;
+    for (int k = 0; k < L.outerSize(); k++) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(L, k); it; ++it) {
+            int r = it.row(), c = it.col();
+            double a = -it.value();
+            if (!on_boundary[r] && !on_boundary[c]) t_ii.emplace_back(index[r], index[c], a);
+            else if (!on_boundary[r]) t_ib.emplace_back(index[r], index[c], a);
+            else if (!on_boundary[c]) t_bi.emplace_back(index[r], index[c], a);
+        }
+    }
+    Eigen::SparseMatrix<double> A_ii(ni, ni), A_ib(ni, nb), A_bi(nb, ni);
+    A_ii.setFromTriplets(t_ii.begin(), t_ii.end());
+    A_ib.setFromTriplets(t_ib.begin(), t_ib.end());
+    A_bi.setFromTriplets(t_bi.begin(), t_bi.end());
+
+    Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> solver;
+    if (ni > 0) {
+        TRACE_SCOPE("factorize");
+        solver.compute(A_ii);
+        if (solver.info() != Eigen::Success) return false;
+    }
+
+    // 1. scale factors with u = 0 on the boundary, target curvature k - du/dn
+    Eigen::VectorXd K_i(ni), k_b(nb);
+    for (int i = 0; i < ni; i++) K_i(i) = K(interior[i]);
+    for (int i = 0; i < nb; i++) k_b(i) = K(bnd(i));
+    // (the normal derivative is the boundary block of the laplacian applied to
+    // u, so the target curvatures sum to 2 pi by discrete Gauss-Bonnet)
+    Eigen::VectorXd k_target = k_b;
+    if (ni > 0) {
+        Eigen::VectorXd u_i = solver.solve(-K_i);
+        k_target += A_bi * u_i;
+    }
+
+    // 2. closed boundary curve: tangents from the target curvature, lengths
+    // l minimizing sum (l - l*)^2 / l* subject to sum l T = 0
+    Eigen::VectorXd length(nb);
+    Eigen::MatrixXd T(2, nb);
+    double phi = 0.0;
+    for (int i = 0; i < nb; i++) {
+        length(i) = (V.row(bnd((i + 1) % nb)) - V.row(bnd(i))).norm();
+        phi += k_target(i);
+        T(0, i) = std::cos(phi);
+        T(1, i) = std::sin(phi);
+    }
+    Eigen::MatrixXd TN = T * length.asDiagonal();
+    Eigen::Matrix2d TNT = TN * T.transpose();
+    Eigen::VectorXd closed = length - TN.transpose() * TNT.inverse() * (T * length);
+    if (closed.minCoeff() <= 0.0) return false;
+
+    Eigen::MatrixXd uv_b(nb, 2);
+    uv_b.row(0).setZero();
+    for (int i = 0; i + 1 < nb; i++) {
+        uv_b.row(i + 1) = uv_b.row(i) + closed(i) * T.col(i).transpose();
+    }
+
+    // 3. harmonic extension, same factorization
+    uv.resize(nv, 2);
+    for (int i = 0; i < nb; i++) uv.row(bnd(i)) = uv_b.row(i);
+    if (ni > 0) {
+        Eigen::MatrixXd rhs = -(A_ib * uv_b);
+        Eigen::MatrixXd uv_i = solver.solve(rhs);
+        for (int i = 0; i < ni; i++) uv.row(interior[i]) = uv_i.row(i);
+    }
+
+    // flip-free or rejected
+    int flipped = 0;
+    for (int f = 0; f < F.rows(); f++) {
+        Eigen::RowVector2d e1 = uv.row(F(f, 1)) - uv.row(F(f, 0));
+        Eigen::RowVector2d e2 = uv.row(F(f, 2)) - uv.row(F(f, 0));
+        flipped += e1.x() * e2.y() - e1.y() * e2.x() <= 0.0;
+    }
+    trace::counter("conformal_flips", flipped);
+    return flipped == 0;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+// Assembly of per-face contributions into a sparse matrix whose pattern never
+// changes. The pattern is built once per mesh from the vertex adjacency,
+// together with a compact scatter map (where the entries of every face block
+// live in the value array) and a coloring of the faces: two faces of the same
+// color share no vertex, so the faces of one color are assembled in parallel
+// without atomics and without triplet lists to sort. The matrix is compressed
+// column major; the patterns built here are symmetric, so its columns are
+// also the rows of the CSR form.
+//
+// The unknowns come in `blocks` per vertex (u and v for a uv map) and couple
+// every block of a vertex with every block of its neighbours. The column of
+// an unknown holds, block after block, the rows of the vertex and of its
+// neighbours in vertex order; a face only stores the rank of each of its
+// corners among the neighbours of the other two (6 ints), and the block
+// offsets are derived from the neighbour counts.
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "trace.hpp"
+
+
+class CsrAssembly {
+public:
+    typedef Eigen::SparseMatrix<double> SpMat;
+
+    // faces F over num_vertices vertices, `blocks` unknowns per vertex;
+    // dof(b, v) is the row of unknown b of vertex v, or -1 if it is not part
+    // of the system. A vertex has all its unknowns or none, and rows increase
+    // with (b, v) in lexicographic order. Every row gets its diagonal entry.
+    template <typename Dof>
+    void build(const Eigen::Ref<const Eigen::MatrixXi> &F, int blocks, int num_vertices, int size, Dof dof)
+    {
+        TRACE_SCOPE("csr_pattern");
+        const int nf = F.rows(), nv = num_vertices;
+        this->blocks = blocks;
+        this->nv = nv;
+        dofs.resize((std::size_t)blocks * nv);
+        for (int b = 0; b < blocks; b++) {
+            for (int v = 0; v < nv; v++) dofs[(std::size_t)b * nv + v] = dof(b, v);
+        }
+
+        // faces around every vertex
+        std::vector<int> face_begin(nv + 1, 0), incident(3 * (std::size_t)nf);
+        for (int f = 0; f < nf; f++)
+            for (int i = 0; i < 3; i++) face_begin[F(f, i) + 1]++;
+        for (int v = 0; v < nv; v++) face_begin[v + 1] += face_begin[v];
+        {
+            std::vector<int> next(face_begin.begin(), face_begin.end() - 1);
+            for (int f = 0; f < nf; f++)
+                for (int i = 0; i < 3; i++) incident[next[F(f, i)]++] = f;
+        }
+
+        // sorted neighbours of every vertex, the vertex itself included:
+        // counted in a first pass, filled in a second
+        std::vector<int> adj_begin(nv + 1, 0);
+        std::vector<int> adj;
+        for (int pass = 0; pass < 2; pass++) {
+            if (pass == 1) {
+                for (int v = 0; v < nv; v++) adj_begin[v + 1] += adj_begin[v];
+                adj.resize(adj_begin[nv]);
+            }
+            #pragma omp parallel
+            {
+                std::vector<int> ring;
+                #pragma omp for schedule(dynamic, 1024)
+                for (int v = 0; v < nv; v++) {
+                    ring.assign(1, v);
+                    for (int k = face_begin[v]; k < face_begin[v + 1]; k++)
+                        for (int i = 0; i < 3; i++) ring.push_back(F(incident[k], i));
+                    std::sort(ring.begin(), ring.end());
+                    ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+                    if (pass == 0) adj_begin[v + 1] = ring.size();
+                    else std::copy(ring.begin(), ring.end(), adj.begin() + adj_begin[v]);
+                }
+            }
+        }
+        std::vector<int>().swap(incident);
+        std::vector<int>().swap(face_begin);
+
+        // rank of every neighbour among the neighbours that are unknowns,
+        // -1 for the others
+        std::vector<int> rank(adj.size());
+        neighbours.assign(nv, 0);
+        self_rank.assign(nv, -1);
+        #pragma omp parallel for
+        for (int v = 0; v < nv; v++) {
+            int count = 0;
+            for (int p = adj_begin[v]; p < adj_begin[v + 1]; p++) {
+                rank[p] = dofs[adj[p]] >= 0 ? count++ : -1;
+                if (adj[p] == v) self_rank[v] = rank[p];
+            }
+            neighbours[v] = count;
+        }
+
+        // the matrix, column by column
+        A.resize(size, size);
+        std::vector<int> column_vertex(size, -1), column_block(size, 0);
+        for (int b = 0; b < blocks; b++) {
+            for (int v = 0; v < nv; v++) {
+                int d = dofs[(std::size_t)b * nv + v];
+                if (d >= 0) {
+                    column_vertex[d] = v;
+                    column_block[d] = b;
+                }
+            }
+        }
+        int *outer = A.outerIndexPtr();
+        outer[0] = 0;
+        for (int d = 0; d < size; d++) {
+            int v = column_vertex[d];
+            outer[d + 1] = outer[d] + (v >= 0 ? blocks * neighbours[v] : 1);
+        }
+        A.resizeNonZeros(outer[size]);
+        int *inner = A.innerIndexPtr();
+        #pragma omp parallel for
+        for (int d = 0; d < size; d++) {
+            int v = column_vertex[d], k = outer[d];
+            if (v < 0) {
+                inner[k] = d;   // a row no face touches
+                continue;
+            }
+            for (int b = 0; b < blocks; b++) {
+                for (int p = adj_begin[v]; p < adj_begin[v + 1]; p++) {
+                    if (rank[p] >= 0) inner[k++] = dofs[(std::size_t)b * nv + adj[p]];
+                }
+            }
+        }
+        std::fill(A.valuePtr(), A.valuePtr() + A.nonZeros(), 0.0);
+
+        diagonal_.resize(size);
+        #pragma omp parallel for
+        for (int d = 0; d < size; d++) {
+            int v = column_vertex[d];
+            diagonal_[d] = v >= 0 ? outer[d] + column_block[d] * neighbours[v] + self_rank[v] : outer[d];
+        }
+
+        // per face, the rank of corner i among the neighbours of corner j
+        face_rank.resize(6 * (std::size_t)nf);
+        #pragma omp parallel for
+        for (int f = 0; f < nf; f++) {
+            for (int j = 0; j < 3; j++) {
+                const int w = F(f, j);
+                const int *begin = adj.data() + adj_begin[w], *end = adj.data() + adj_begin[w + 1];
+                for (int i = 0; i < 3; i++) {
+                    if (i == j) continue;
+                    int p = (int)(std::lower_bound(begin, end, F(f, i)) - adj.data());
+                    face_rank[6 * (std::size_t)f + pair(i, j)] = rank[p];
+                }
+            }
+        }
+
+        color_faces(F);
+    }
+
+    bool empty() const { return A.rows() == 0; }
+    int colors() const { return (int)color_begin.size() - 1; }
+
+    void set_zero() { std::fill(A.valuePtr(), A.valuePtr() + A.nonZeros(), 0.0); }
+    double *values() { return A.valuePtr(); }
+    SpMat &matrix() { return A; }
+
+    // position in values() of the (r, c) entry of the block of face f, -1 if
+    // absent; local unknown r is block r / 3 of corner r % 3
+    int slot(const Eigen::Ref<const Eigen::MatrixXi> &F, int f, int r, int c) const
+    {
+        const int i = r % 3, j = c % 3, w = F(f, j);
+        const int column = dofs[(std::size_t)(c / 3) * nv + w];
+        const int rank = i == j ? self_rank[w] : face_rank[6 * (std::size_t)f + pair(i, j)];
+        if (column < 0 || rank < 0) return -1;
+        return A.outerIndexPtr()[column] + (r / 3) * neighbours[w] + rank;
+    }
+    int diagonal(int i) const { return diagonal_[i]; }
+
+    // calls body(f) for every face; faces sharing a vertex are never visited
+    // concurrently, so body may accumulate into the rows of its vertices
+    template <typename Body>
+    void for_each_face(Body body) const
+    {
+        for (int c = 0; c < colors(); c++) {
+            const int begin = color_begin[c], end = color_begin[c + 1];
+            if (c == overflow_color) {
+                for (int i = begin; i < end; i++) body(colored[i]);
+                continue;
+            }
+            #pragma omp parallel for schedule(static)
+            for (int i = begin; i < end; i++) body(colored[i]);
+        }
+    }
+
+private:
+    // index of the ordered corner pair (i, j), i != j, among the 6 of a face
+    static int pair(int i, int j) { return 2 * j + (i > j ? i - 1 : i); }
+
+    // greedy coloring with one bit per color and vertex; the rare faces that
+    // find all 64 colors taken go to a last color assembled serially
+    void color_faces(const Eigen::Ref<const Eigen::MatrixXi> &F)
+    {
+        const int nf = F.rows();
+        const int nv = nf > 0 ? F.maxCoeff() + 1 : 0;
+        std::vector<std::uint64_t> used(nv, 0);
+        std::vector<int> color(nf);
+        int num_colors = 0;
+        bool overflow = false;
+        for (int f = 0; f < nf; f++) {
+            std::uint64_t taken = 0;
+            for (int i = 0; i < F.cols(); i++) taken |= used[F(f, i)];
+            if (~taken == 0) {
+                color[f] = 64;
+                overflow = true;
+                continue;
+            }
+            int c = 0;
+            while (taken & (std::uint64_t(1) << c)) c++;
+            color[f] = c;
+            num_colors = std::max(num_colors, c + 1);
+            for (int i = 0; i < F.cols(); i++) used[F(f, i)] |= std::uint64_t(1) << c;
+        }
+        overflow_color = -1;
+        if (overflow) {
+            overflow_color = num_colors;
+            for (int f = 0; f < nf; f++) {
+                if (color[f] == 64) color[f] = overflow_color;
+            }
+            num_colors++;
+        }
+
+        // faces grouped by color, in mesh order within a color
+        color_begin.assign(num_colors + 1, 0);
+        for (int f = 0; f < nf; f++) color_begin[color[f] + 1]++;
+        for (int c = 0; c < num_colors; c++) color_begin[c + 1] += color_begin[c];
+        colored.resize(nf);
+        std::vector<int> next(color_begin.begin(), color_begin.end() - 1);
+        for (int f = 0; f < nf; f++) colored[next[color[f]]++] = f;
+        trace::counter("face_colors", num_colors);
+    }
+
+    SpMat A;
+    int blocks = 0;
+    int nv = 0;
+    std::vector<int> dofs;          // blocks x nv, row of every unknown, -1 if absent
+    std::vector<int> neighbours;    // per vertex, neighbours (itself included) that are unknowns
+    std::vector<int> self_rank;     // per vertex, its own rank among them
+    std::vector<int> face_rank;     // F x 6, rank of corner i among the neighbours of corner j
+    std::vector<int> diagonal_;     // position of A(i, i)
+    std::vector<int> colored;       // faces sorted by color
+    std::vector<int> color_begin;   // colored[color_begin[c] .. color_begin[c + 1]) have color c
+    int overflow_color = -1;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+// Distortion metrics of a parametrization, evaluated per face from the
+// singular values s1 >= s2 of the jacobian of the 3D -> uv map:
+//   conformal distortion  s1 / s2                          (1 is angle preserving)
+//   area distortion       max(s1 s2, 1 / (s1 s2)) after scaling the uv layout
+//                         to the 3D surface area           (1 is area preserving)
+//   symmetric dirichlet   s1^2 + s2^2 + 1/s1^2 + 1/s2^2    (4 is isometric)
+// Flipped and degenerate faces are counted and left out of the averages.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "jacobian2d.hpp"
+#include "mesh_operators.hpp"
+
+
+// upper edges of the histogram bins, the last bin collects everything above
+static const int DISTORTION_BINS = 8;
+static const double distortion_bin_edges[DISTORTION_BINS - 1] = {1.01, 1.05, 1.1, 1.25, 1.5, 2.0, 4.0};
+
+struct DistortionStats {
+    int num_faces = 0;
+    int flips = 0;              // faces with orientation opposite to the majority
+    int degenerate = 0;         // zero area faces in 3D or in uv
+    bool mirrored = false;      // majority of the faces has negative determinant
+
+    double area_3d = 0.0;
+    double area_uv = 0.0;
+
+    // area weighted means and maxima over the valid faces
+    double symmetric_dirichlet = 0.0;
+    double symmetric_dirichlet_max = 0.0;
+    double conformal_mean = 0.0;
+    double conformal_max = 0.0;
+    double area_mean = 0.0;
+    double area_max = 0.0;
+
+    int conformal_hist[DISTORTION_BINS] = {0};
+    int area_hist[DISTORTION_BINS] = {0};
+
+    Eigen::MatrixXd singular_values;   // F x 2, only filled on request
+};
+
+inline int distortion_bin(double x)
+{
+    int bin = 0;
+    while (bin < DISTORTION_BINS - 1 && x > distortion_bin_edges[bin]) bin++;
+    return bin;
+}
+
+// V, F: 3D mesh. UV, FUV: uv coordinates and their faces (FUV = F for per
+// vertex uvs). Singular values are stored per face when per_face is set.
+inline DistortionStats compute_distortion(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                                          const Eigen::Ref<const Eigen::MatrixXd> &UV, const Eigen::Ref<const Eigen::MatrixXi> &FUV,
+                                          bool per_face = false)
+{
+    const int nf = F.rows();
+    DistortionStats stats;
+    stats.num_faces = nf;
+
+    Eigen::VectorXd area;
+    FaceGradients grad;
+    local_gradients(V, F, area, grad);
+
+    // signed uv areas decide the orientation and the global scale
+    Eigen::VectorXd area_uv(nf);
+    int negative = 0;
+    double total_3d = 0.0, total_uv = 0.0;
+    #pragma omp parallel for reduction(+:negative,total_3d,total_uv)
+    for (int f = 0; f < nf; f++) {
+        Eigen::RowVector2d a = UV.row(FUV(f, 0)).head<2>();
+        Eigen::RowVector2d b = UV.row(FUV(f, 1)).head<2>() - a;
+        Eigen::RowVector2d c = UV.row(FUV(f, 2)).head<2>() - a;
+        area_uv(f) = 0.5 * (b.x() * c.y() - b.y() * c.x());
+        negative += area_uv(f) < 0.0;
+        total_3d += area(f);
+        total_uv += std::abs(area_uv(f));
+    }
+    stats.mirrored = 2 * negative > nf;
+    stats.area_3d = total_3d;
+    stats.area_uv = total_uv;
+    const double sign = stats.mirrored ? -1.0 : 1.0;
+    const double scale = total_uv > 0.0 ? total_3d / total_uv : 1.0;  // uv area rescaling
+
+    if (per_face) stats.singular_values.setConstant(nf, 2, std::numeric_limits<double>::quiet_NaN());
+
+    int flips = 0, degenerate = 0;
+    double valid_area = 0.0, sd_sum = 0.0, sd_max = 0.0;
+    double conf_sum = 0.0, conf_max = 0.0, area_sum = 0.0, area_max = 0.0;
+    int conformal_hist[DISTORTION_BINS] = {0};
+    int area_hist[DISTORTION_BINS] = {0};
+
+    #pragma omp parallel for reduction(+:flips,degenerate,valid_area,sd_sum,conf_sum,area_sum) \
+        reduction(max:sd_max,conf_max,area_max) \
+        reduction(+:conformal_hist[:DISTORTION_BINS],area_hist[:DISTORTION_BINS])
+    for (int f = 0; f < nf; f++) {
+        const double signed_uv = sign * area_uv(f);
+        if (area(f) <= 0.0 || !std::isfinite(area(f)) || signed_uv == 0.0) {
+            degenerate++;
+            continue;
+        }
+        if (signed_uv < 0.0) {
+            flips++;
+            continue;
+        }
+
+        double u[3], v[3];
+        for (int i = 0; i < 3; i++) {
+            u[i] = sign * UV(FUV(f, i), 0);
+            v[i] = UV(FUV(f, i), 1);
+        }
+        double a = 0.0, b = 0.0, c = 0.0, d = 0.0;
+        for (int i = 0; i < 3; i++) {
+            a += u[i] * grad(f, i);
+            b += u[i] * grad(f, 3 + i);
+            c += v[i] * grad(f, i);
+            d += v[i] * grad(f, 3 + i);
+        }
+        double s1, s2;
+        singular_values2x2(a, b, c, d, s1, s2);
+        if (per_face) {
+            stats.singular_values(f, 0) = s1;
+            stats.singular_values(f, 1) = s2;
+        }
+
+        double sd = s1 * s1 + s2 * s2 + 1.0 / (s1 * s1) + 1.0 / (s2 * s2);
+        double conformal = s1 / s2;
+        double stretch = s1 * s2 * scale;
+        double areal = std::max(stretch, 1.0 / stretch);
+
+        valid_area += area(f);
+        sd_sum += area(f) * sd;
+        conf_sum += area(f) * conformal;
+        area_sum += area(f) * areal;
+        sd_max = std::max(sd_max, sd);
+        conf_max = std::max(conf_max, conformal);
+        area_max = std::max(area_max, areal);
+        conformal_hist[distortion_bin(conformal)]++;
+        area_hist[distortion_bin(areal)]++;
+    }
+
+    stats.flips = flips;
+    stats.degenerate = degenerate;
+    if (valid_area > 0.0) {
+        stats.symmetric_dirichlet = sd_sum / valid_area;
+        stats.conformal_mean = conf_sum / valid_area;
+        stats.area_mean = area_sum / valid_area;
+    }
+    stats.symmetric_dirichlet_max = sd_max;
+    stats.conformal_max = conf_max;
+    stats.area_max = area_max;
+    std::copy(conformal_hist, conformal_hist + DISTORTION_BINS, stats.conformal_hist);
+    std::copy(area_hist, area_hist + DISTORTION_BINS, stats.area_hist);
+    return stats;
+}
+
+inline DistortionStats compute_distortion(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                                          const Eigen::Ref<const Eigen::MatrixXd> &UV, bool per_face = false)
+{
+    return compute_distortion(V, F, UV, F, per_face);
+}
+
+inline void print_distortion(FILE *out, const DistortionStats &stats)
+{
+    fprintf(out, "faces                %d\n", stats.num_faces);
+    fprintf(out, "flipped              %d%s\n", stats.flips, stats.mirrored ? " (layout is mirrored)" : "");
+    fprintf(out, "degenerate           %d\n", stats.degenerate);
+    fprintf(out, "area 3d / uv         %g / %g\n", stats.area_3d, stats.area_uv);
+    fprintf(out, "symmetric dirichlet  mean %g  max %g\n", stats.symmetric_dirichlet, stats.symmetric_dirichlet_max);
+    fprintf(out, "conformal            mean %g  max %g\n", stats.conformal_mean, stats.conformal_max);
+    fprintf(out, "area                 mean %g  max %g\n", stats.area_mean, stats.area_max);
+
+    fprintf(out, "%-12s %10s %10s\n", "bin", "conformal", "area");
+    for (int i = 0; i < DISTORTION_BINS; i++) {
+        char label[32];
+        if (i < DISTORTION_BINS - 1) snprintf(label, sizeof(label), "<= %g", distortion_bin_edges[i]);
+        else snprintf(label, sizeof(label), "> %g", distortion_bin_edges[i - 1]);
+        fprintf(out, "%-12s %10d %10d\n", label, stats.conformal_hist[i], stats.area_hist[i]);
+    }
+}
@@ -0,0 +1,346 @@
+#pragma once
+
+// Incremental reparametrization after a local edit: the uv of a previous
+// result is transferred to the edited mesh wherever the geometry did not
+// change, and SLIM is re-run only on a ring of faces around the edit with
+// everything outside it held fixed. The solve scales with the edit, not with
+// the mesh.
+
+#include <igl/slim.h>
+#include <igl/flipped_triangles.h>
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "amg.hpp"
+#include "mesh_operators.hpp"
+#include "trace.hpp"
+
+
+struct IncrementalResult {
+    Eigen::MatrixXd uv;         // uv of the edited mesh
+    int changed_faces = 0;      // faces not present in the previous mesh
+    int region_faces = 0;       // faces actually re-solved
+    int rings = 0;              // rings around the edit in the final region
+    double energy = 0.0;        // slim energy of the re-solved region
+};
+
+namespace incremental {
+
+// vertex positions are matched within eps, so the edited mesh may be written
+// with less precision than our %0.17g outputs; previous vertices are hashed
+// on a grid of cell size eps and a vertex looks at its cell and the 26
+// around it, which holds every position within eps
+struct PositionKey {
+    std::int64_t x, y, z;
+    bool operator==(const PositionKey &o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct PositionHash {
+    std::size_t operator()(const PositionKey &k) const
+    {
+        std::uint64_t h = 1469598103934665603ull;
+        for (std::int64_t c : {k.x, k.y, k.z}) {
+            h ^= (std::uint64_t)c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+inline PositionKey position_key(const Eigen::Ref<const Eigen::MatrixXd> &V, int i, double eps)
+{
+    return { (std::int64_t)std::floor(V(i, 0) / eps),
+             (std::int64_t)std::floor(V(i, 1) / eps),
+             (std::int64_t)std::floor(V(i, 2) / eps) };
+}
+
+// face key independent of the starting corner, orientation preserved
+inline std::array<int, 3> face_key(int a, int b, int c)
+{
+    if (a < b && a < c) return {a, b, c};
+    if (b < a && b < c) return {b, c, a};
+    return {c, a, b};
+}
+
+struct FaceHash {
+    std::size_t operator()(const std::array<int, 3> &f) const
+    {
+        return ((std::size_t)f[0] * 73856093u) ^ ((std::size_t)f[1] * 19349663u) ^ ((std::size_t)f[2] * 83492791u);
+    }
+};
+
+// for each vertex of V the vertex of V_prev at the same position, or -1
+inline std::vector<int> match_vertices(const Eigen::Ref<const Eigen::MatrixXd> &V_prev, const Eigen::Ref<const Eigen::MatrixXd> &V)
+{
+    double diag = (V_prev.colwise().maxCoeff() - V_prev.colwise().minCoeff()).norm();
+    double eps = std::max(diag, 1.0) * 1e-9;
+
+    std::unordered_multimap<PositionKey, int, PositionHash> lookup;
+    lookup.reserve(V_prev.rows());
+    for (int i = 0; i < V_prev.rows(); i++) lookup.emplace(position_key(V_prev, i, eps), i);
+
+    // the closest previous vertex with every coordinate within eps
+    std::vector<int> match(V.rows(), -1);
+    for (int i = 0; i < V.rows(); i++) {
+        const PositionKey key = position_key(V, i, eps);
+        double closest = INFINITY;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dz = -1; dz <= 1; dz++) {
+                    auto range = lookup.equal_range({ key.x + dx, key.y + dy, key.z + dz });
+                    for (auto it = range.first; it != range.second; ++it) {
+                        const int j = it->second;
+                        if ((V_prev.row(j) - V.row(i)).cwiseAbs().maxCoeff() > eps) continue;
+                        const double distance = (V_prev.row(j) - V.row(i)).squaredNorm();
+                        if (distance < closest || (distance == closest && j < match[i])) {
+                            closest = distance;
+                            match[i] = j;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return match;
+}
+
+// faces of F whose three corners match a face of F_prev
+inline std::vector<bool> unchanged_faces(const Eigen::Ref<const Eigen::MatrixXi> &F_prev, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                                         const std::vector<int> &match)
+{
+    std::unordered_set<std::array<int, 3>, FaceHash> prev;
+    prev.reserve(F_prev.rows());
+    for (int f = 0; f < F_prev.rows(); f++) prev.insert(face_key(F_prev(f, 0), F_prev(f, 1), F_prev(f, 2)));
+
+    std::vector<bool> unchanged(F.rows(), false);
+    for (int f = 0; f < F.rows(); f++) {
+        int a = match[F(f, 0)], b = match[F(f, 1)], c = match[F(f, 2)];
+        unchanged[f] = a != -1 && b != -1 && c != -1 && prev.count(face_key(a, b, c));
+    }
+    return unchanged;
+}
+
+// extracts the faces in region as a standalone mesh; sub_to_full maps back
+inline void extract_submesh(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                            const std::vector<int> &region,
+                            Eigen::MatrixXd &V_sub, Eigen::MatrixXi &F_sub,
+                            std::vector<int> &sub_to_full)
+{
+    std::unordered_map<int, int> full_to_sub;
+    sub_to_full.clear();
+    F_sub.resize(region.size(), 3);
+    for (std::size_t r = 0; r < region.size(); r++) {
+        for (int k = 0; k < 3; k++) {
+            int v = F(region[r], k);
+            auto it = full_to_sub.find(v);
+            if (it == full_to_sub.end()) {
+                it = full_to_sub.emplace(v, (int)sub_to_full.size()).first;
+                sub_to_full.push_back(v);
+            }
+            F_sub(r, k) = it->second;
+        }
+    }
+    V_sub.resize(sub_to_full.size(), V.cols());
+    for (std::size_t i = 0; i < sub_to_full.size(); i++) V_sub.row(i) = V.row(sub_to_full[i]);
+}
+
+// Dirichlet interpolation of the unknown uv, fixed rows of uv untouched;
+// tries the cotangent then the uniform laplacian
+inline bool interpolate(MeshOperators &ops, const Eigen::MatrixXi &F_sub,
+                        const std::vector<int> &fixed, Eigen::MatrixXd &uv)
+{
+    Eigen::VectorXi b(fixed.size());
+    Eigen::MatrixXd bc(fixed.size(), 2);
+    for (std::size_t i = 0; i < fixed.size(); i++) {
+        b(i) = fixed[i];
+        bc.row(i) = uv.row(fixed[i]);
+    }
+    if (harmonic_amg(ops.cotangent_laplacian(), b, bc, uv) && igl::flipped_triangles(uv, F_sub).size() == 0) {
+        return true;
+    }
+    return harmonic_amg(ops.uniform_laplacian(), b, bc, uv) && igl::flipped_triangles(uv, F_sub).size() == 0;
+}
+
+} // namespace incremental
+
+
+// Re-solves the edited mesh (V, F) starting from the previous result
+// (V_prev, F_prev, uv_prev with one uv per vertex). When bnd is given the mesh
+// boundary is pinned to bnd_uv as in slim_bnd, otherwise it is free as in
+// freeslim; an empty bnd_uv pins it to the previous uv. The region starts `rings` rings around the changed faces and is
+// doubled only while the initialization or the solve produces flips.
+inline bool incremental_slim(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                             const Eigen::Ref<const Eigen::MatrixXd> &V_prev, const Eigen::Ref<const Eigen::MatrixXi> &F_prev,
+                             const Eigen::Ref<const Eigen::MatrixXd> &uv_prev,
+                             const Eigen::VectorXi &bnd, const Eigen::MatrixXd &bnd_uv,
+                             int iterations, int rings, IncrementalResult &result)
+{
+    using namespace incremental;
+    TRACE_SCOPE("incremental");
+
+    std::vector<int> match = match_vertices(V_prev, V);
+    std::vector<bool> unchanged = unchanged_faces(F_prev, F, match);
+
+    // uv transferred from the previous result
+    result.uv = Eigen::MatrixXd::Zero(V.rows(), 2);
+    std::vector<bool> known(V.rows(), false);
+    for (int i = 0; i < V.rows(); i++) {
+        if (match[i] != -1) {
+            result.uv.row(i) = uv_prev.row(match[i]);
+            known[i] = true;
+        }
+    }
+    // without bnd_uv the boundary stays where the previous result put it
+    std::vector<bool> pinned(V.rows(), false);
+    for (int i = 0; i < bnd.size(); i++) {
+        if (bnd_uv.rows() == bnd.size()) {
+            result.uv.row(bnd(i)) = bnd_uv.row(i);
+            known[bnd(i)] = true;
+        }
+        pinned[bnd(i)] = known[bnd(i)];
+    }
+
+    std::vector<int> seeds;
+    for (int f = 0; f < F.rows(); f++) {
+        if (!unchanged[f]) seeds.push_back(f);
+    }
+    result.changed_faces = seeds.size();
+    trace::counter("changed_faces", seeds.size());
+    if (seeds.empty()) {
+        std::cout << "No changed faces, previous parametrization reused" << std::endl;
+        return true;
+    }
+
+    // vertex to face adjacency, for growing rings
+    std::vector<int> vf_start(V.rows() + 1, 0), vf;
+    for (int f = 0; f < F.rows(); f++) for (int k = 0; k < 3; k++) vf_start[F(f, k) + 1]++;
+    for (int i = 0; i < V.rows(); i++) vf_start[i + 1] += vf_start[i];
+    vf.resize(vf_start.back());
+    {
+        std::vector<int> fill(vf_start.begin(), vf_start.end() - 1);
+        for (int f = 0; f < F.rows(); f++) for (int k = 0; k < 3; k++) vf[fill[F(f, k)]++] = f;
+    }
+
+    std::vector<char> in_region(F.rows(), 0);
+    std::vector<int> region = seeds;
+    for (int f : seeds) in_region[f] = 1;
+    int grown = 0;
+    std::size_t attempted = 0;
+
+    auto grow = [&](int target) {
+        while (grown < target && (int)region.size() < F.rows()) {
+            std::size_t end = region.size();
+            for (std::size_t r = 0; r < end; r++) {
+                for (int k = 0; k < 3; k++) {
+                    int v = F(region[r], k);
+                    for (int j = vf_start[v]; j < vf_start[v + 1]; j++) {
+                        if (!in_region[vf[j]]) {
+                            in_region[vf[j]] = 1;
+                            region.push_back(vf[j]);
+                        }
+                    }
+                }
+            }
+            grown++;
+        }
+    };
+
+    for (int target = std::max(rings, 1); ; target *= 2) {
+        grow(target);
+        if (region.size() == attempted) break; // the region cannot grow any further
+        attempted = region.size();
+        bool whole_mesh = (int)region.size() == F.rows();
+        std::cout << "Re-solving " << region.size() << " of " << F.rows() << " faces (" << grown << " rings)" << std::endl;
+
+        Eigen::MatrixXd V_sub;
+        Eigen::MatrixXi F_sub;
+        std::vector<int> sub_to_full;
+        extract_submesh(V, F, region, V_sub, F_sub, sub_to_full);
+
+        // region vertices touching faces outside the region keep their uv
+        std::vector<int> fixed;
+        std::vector<int> fixed_known;
+        Eigen::MatrixXd uv_sub(V_sub.rows(), 2);
+        for (std::size_t i = 0; i < sub_to_full.size(); i++) {
+            int v = sub_to_full[i];
+            uv_sub.row(i) = result.uv.row(v);
+            bool outside = pinned[v];
+            for (int j = vf_start[v]; j < vf_start[v + 1] && !outside; j++) outside = !in_region[vf[j]];
+            if (outside) fixed.push_back(i);
+            if (known[v]) fixed_known.push_back(i);
+        }
+        if (fixed.empty() && bnd.size() == 0) {
+            // free boundary over the whole mesh: pin one vertex to remove the translation
+            fixed.push_back(fixed_known.empty() ? 0 : fixed_known[0]);
+        }
+
+        MeshOperators ops(V_sub, F_sub);
+        Eigen::MatrixXd uv_init = uv_sub;
+        bool init_ok;
+        {
+            TRACE_SCOPE("init");
+            // keep the transferred layout and only interpolate new vertices,
+            // then fall back to re-interpolating the whole region
+            init_ok = !fixed_known.empty() && interpolate(ops, F_sub, fixed_known, uv_init);
+            if (!init_ok) {
+                uv_init = uv_sub;
+                init_ok = interpolate(ops, F_sub, fixed, uv_init);
+            }
+        }
+        if (!init_ok) {
+            if (whole_mesh) break;
+            std::cout << "Flipped initialization, widening the region" << std::endl;
+            continue;
+        }
+
+        Eigen::VectorXi b(fixed.size());
+        Eigen::MatrixXd bc(fixed.size(), 2);
+        for (std::size_t i = 0; i < fixed.size(); i++) {
+            b(i) = fixed[i];
+            bc.row(i) = uv_init.row(fixed[i]);
+        }
+
+        igl::SLIMData data;
+        {
+            TRACE_SCOPE("solve");
+            igl::slim_precompute(V_sub, F_sub, uv_init, data, igl::MappingEnergyType::SYMMETRIC_DIRICHLET, b, bc, 1e35);
+            igl::slim_solve(data, iterations);
+        }
+
+        if (igl::flipped_triangles(data.V_o, F_sub).size() != 0) {
+            if (whole_mesh) break;
+            std::cout << "Flipped faces after solve, widening the region" << std::endl;
+            continue;
+        }
+
+        for (std::size_t i = 0; i < sub_to_full.size(); i++) result.uv.row(sub_to_full[i]) = data.V_o.row(i);
+        result.region_faces = region.size();
+        result.rings = grown;
+        result.energy = data.energy;
+        trace::counter("region_faces", region.size());
+        return true;
+    }
+
+    std::cerr << "Error! Incremental solve could not find a flip-free region" << std::endl;
+    return false;
+}
+
+// uv per vertex of a result written by our tools (v/vt/f with v/vt indices)
+inline Eigen::MatrixXd uv_per_vertex(int num_vertices, const Eigen::MatrixXi &F,
+                                     const Eigen::MatrixXd &TC, const Eigen::MatrixXi &FTC)
+{
+    Eigen::MatrixXd uv = Eigen::MatrixXd::Zero(num_vertices, 2);
+    for (int f = 0; f < F.rows(); f++) {
+        for (int k = 0; k < 3; k++) uv.row(F(f, k)) = TC.row(FTC(f, k)).head<2>();
+    }
+    return uv;
+}
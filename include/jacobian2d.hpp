@@ -0,0 +1,66 @@
+#pragma once
+
+// Closed form 2x2 polar/singular value decomposition of per-face jacobians.
+// Branch free apart from atan2, so the per-face loops vectorize well.
+
+#include <algorithm>
+#include <cmath>
+
+
+// J = [a b; c d] = Rot(phi) diag(s1, s2) Rot(theta), s1 >= |s2|, s2 < 0 iff det(J) < 0.
+// The closest rotation to J is Rot(phi + theta).
+struct Svd2 {
+    double s1, s2;
+    double phi, theta;
+};
+
+inline Svd2 svd2x2(double a, double b, double c, double d)
+{
+    double E = (a + d) / 2.0;
+    double F = (a - d) / 2.0;
+    double G = (c + b) / 2.0;
+    double H = (c - b) / 2.0;
+    double Q = std::sqrt(E * E + H * H);
+    double R = std::sqrt(F * F + G * G);
+    double a1 = std::atan2(G, F);
+    double a2 = std::atan2(H, E);
+
+    Svd2 svd;
+    svd.s1 = Q + R;
+    svd.s2 = Q - R;
+    svd.theta = (a2 - a1) / 2.0;
+    svd.phi = (a2 + a1) / 2.0;
+    return svd;
+}
+
+// singular values only
+inline void singular_values2x2(double a, double b, double c, double d, double &s1, double &s2)
+{
+    double E = (a + d) / 2.0, F = (a - d) / 2.0, G = (c + b) / 2.0, H = (c - b) / 2.0;
+    double Q = std::sqrt(E * E + H * H);
+    double R = std::sqrt(F * F + G * G);
+    s1 = Q + R;
+    s2 = Q - R;
+}
+
+// smallest positive root of a t^2 + b t + c, or +inf
+inline double smallest_positive_root(double a, double b, double c)
+{
+    const double inf = INFINITY;
+    if (std::abs(a) < 1e-20) {
+        if (std::abs(b) < 1e-20) return inf;
+        double t = -c / b;
+        return t > 0 ? t : inf;
+    }
+    double delta = b * b - 4.0 * a * c;
+    if (delta < 0) return inf;
+    double sq = std::sqrt(delta);
+    // numerically stable pair of roots
+    double q = -0.5 * (b + (b >= 0 ? sq : -sq));
+    double t1 = q / a;
+    double t2 = q != 0.0 ? c / q : inf;
+    double t = inf;
+    if (t1 > 0) t = std::min(t, t1);
+    if (t2 > 0) t = std::min(t, t2);
+    return t;
+}
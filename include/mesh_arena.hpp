@@ -0,0 +1,140 @@
+#pragma once
+
+// Bump allocation for node based CGAL meshes (Polyhedron_3 allocates every
+// vertex, halfedge pair and face separately). Nodes are carved out of large
+// chunks reserved from the element counts, so building a mesh does one
+// allocation per chunk instead of one per element, and nodes built one after
+// the other sit next to each other in memory. Nothing is freed node by node:
+// a mesh in an arena is never destroyed, its teardown is skipped and the
+// arena releases all of it at once, chunk by chunk.
+//
+// An arena is used by one thread: ArenaAllocator allocates from the arena of
+// the innermost ArenaScope of the calling thread.
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+class MeshArena {
+public:
+    MeshArena() {}
+    MeshArena(const MeshArena &) = delete;
+    MeshArena &operator=(const MeshArena &) = delete;
+    ~MeshArena()
+    {
+        for (char *chunk : chunks) ::operator delete(chunk);
+    }
+
+    // the next chunk holds at least `bytes`
+    void reserve(std::size_t bytes)
+    {
+        if ((std::size_t)(end - current) < bytes) next_chunk = std::max(next_chunk, bytes);
+    }
+
+    void *allocate(std::size_t bytes, std::size_t alignment)
+    {
+        std::size_t skip = (alignment - (std::size_t)current % alignment) % alignment;
+        if (current == nullptr || (std::size_t)(end - current) < skip + bytes) {
+            std::size_t size = std::max(next_chunk, bytes + alignment);
+            current = static_cast<char *>(::operator new(size));
+            end = current + size;
+            chunks.push_back(current);
+            next_chunk = std::size_t(1) << 20;  // a reservation is used once
+            skip = (alignment - (std::size_t)current % alignment) % alignment;
+        }
+        void *p = current + skip;
+        current += skip + bytes;
+        return p;
+    }
+
+    // constructs a T in the arena; it is never destroyed, see above
+    template <class T, class... Args>
+    T *create(Args &&... args)
+    {
+        return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    std::size_t num_chunks() const { return chunks.size(); }
+
+private:
+    std::vector<char *> chunks;
+    char *current = nullptr;
+    char *end = nullptr;
+    std::size_t next_chunk = std::size_t(1) << 20;
+};
+
+inline MeshArena *&current_mesh_arena()
+{
+    static thread_local MeshArena *arena = nullptr;
+    return arena;
+}
+
+// the arena of the innermost scope; outside of any scope a process wide
+// arena that is never released
+inline MeshArena &mesh_arena()
+{
+    if (current_mesh_arena() != nullptr) return *current_mesh_arena();
+    static MeshArena *arena = new MeshArena();
+    return *arena;
+}
+
+// makes `arena` the one of this thread until the end of the scope
+class ArenaScope {
+public:
+    explicit ArenaScope(MeshArena &arena) : previous(current_mesh_arena()) { current_mesh_arena() = &arena; }
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+    ~ArenaScope() { current_mesh_arena() = previous; }
+
+private:
+    MeshArena *previous;
+};
+
+
+// Standard allocator on mesh_arena(), for the Alloc parameter of
+// CGAL::Polyhedron_3; deallocate is a no-op.
+template <class T>
+struct ArenaAllocator {
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    template <class U> struct rebind { typedef ArenaAllocator<U> other; };
+
+    ArenaAllocator() {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U> &) {}
+
+    T *allocate(std::size_t n, const void * = nullptr)
+    {
+        return static_cast<T *>(mesh_arena().allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *, std::size_t) {}
+
+    template <class U, class... Args>
+    void construct(U *p, Args &&... args) { ::new ((void *)p) U(std::forward<Args>(args)...); }
+    template <class U>
+    void destroy(U *p) { p->~U(); }
+    std::size_t max_size() const { return std::numeric_limits<std::size_t>::max() / sizeof(T); }
+
+    template <class U> bool operator==(const ArenaAllocator<U> &) const { return true; }
+    template <class U> bool operator!=(const ArenaAllocator<U> &) const { return false; }
+};
+
+
+// reserves room in mesh_arena() for a polyhedron with these counts: a
+// disk-like mesh has about V + F edges, so twice as many halfedges
+template <class Polyhedron>
+void reserve_polyhedron(std::size_t num_vertices, std::size_t num_faces)
+{
+    std::size_t halfedges = 2 * (num_vertices + num_faces);
+    mesh_arena().reserve(sizeof(Polyhedron) + num_vertices * sizeof(typename Polyhedron::Vertex) +
+                         halfedges * sizeof(typename Polyhedron::Halfedge) +
+                         num_faces * sizeof(typename Polyhedron::Facet) + (std::size_t(1) << 16));
+}
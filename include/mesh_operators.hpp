@@ -0,0 +1,164 @@
+#pragma once
+
+// Per-mesh differential operators, assembled once and shared between the
+// harmonic initialization and the parametrization solvers.
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/Sparse>
+
+#include <cmath>
+#include <new>
+#include <vector>
+
+#include "csr_assembly.hpp"
+
+
+// one row of hat function gradients per face, contiguous per face
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> FaceGradients;
+
+// faces kept by reference: the caller keeps the array alive and unchanged
+typedef Eigen::Map<const Eigen::MatrixXi, 0, Eigen::OuterStride<>> FaceView;
+
+// points `view` at F; a Map is re-pointed by constructing it again
+inline void view_faces(FaceView &view, const Eigen::Ref<const Eigen::MatrixXi> &F)
+{
+    new (&view) FaceView(F.data(), F.rows(), F.cols(), Eigen::OuterStride<>(F.outerStride()));
+}
+
+// Per face area and gradients of the hat functions in a local orthonormal
+// frame of the face. For face f and corner i the gradient of the i-th hat
+// function is (grad(f, i), grad(f, 3 + i)), so the jacobian of a uv map is
+//   J = [ sum_i u_i grad(f,i)  sum_i u_i grad(f,3+i) ]
+//       [ sum_i v_i grad(f,i)  sum_i v_i grad(f,3+i) ]
+inline void local_gradients(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                            Eigen::VectorXd &area, FaceGradients &grad)
+{
+    area.resize(F.rows());
+    grad.resize(F.rows(), 6);
+
+    #pragma omp parallel for
+    for (int f = 0; f < (int)F.rows(); f++) {
+        Eigen::Vector3d p0 = V.row(F(f, 0)).head<3>().transpose();
+        Eigen::Vector3d e1 = V.row(F(f, 1)).head<3>().transpose() - p0;
+        Eigen::Vector3d e2 = V.row(F(f, 2)).head<3>().transpose() - p0;
+
+        // local frame: x along e1, y in the face plane
+        double l1 = e1.norm();
+        Eigen::Vector3d x = e1 / l1;
+        Eigen::Vector3d n = e1.cross(e2);
+        double dblA = n.norm();
+        Eigen::Vector3d y = n.cross(x) / dblA;
+
+        Eigen::Vector2d q[3];
+        q[0] = Eigen::Vector2d(0.0, 0.0);
+        q[1] = Eigen::Vector2d(l1, 0.0);
+        q[2] = Eigen::Vector2d(e2.dot(x), e2.dot(y));
+
+        area(f) = dblA / 2.0;
+        for (int i = 0; i < 3; i++) {
+            Eigen::Vector2d d = q[(i + 2) % 3] - q[(i + 1) % 3];
+            grad(f, i)     = -d.y() / dblA;
+            grad(f, 3 + i) =  d.x() / dblA;
+        }
+    }
+}
+
+
+struct MeshOperators {
+    Eigen::VectorXd area;   // per face area
+    FaceGradients grad;     // per face hat function gradients, see local_gradients
+    int num_vertices = 0;
+
+    MeshOperators() {}
+    MeshOperators(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F) { compute(V, F); }
+    MeshOperators(const MeshOperators &) = delete;
+    MeshOperators &operator=(const MeshOperators &) = delete;
+
+    // F is not copied, it must outlive the operators
+    void compute(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F)
+    {
+        view_faces(this->F, F);
+        num_vertices = V.rows();
+        local_gradients(V, F, area, grad);
+        pattern = CsrAssembly();
+        L_cot.resize(0, 0);
+        L_uniform.resize(0, 0);
+    }
+
+    // cotangent laplacian, negative semi-definite like igl::cotmatrix
+    // (L_ij = (cot a_ij + cot b_ij) / 2), assembled on first use
+    const Eigen::SparseMatrix<double> &cotangent_laplacian()
+    {
+        if (L_cot.rows() == 0) {
+            build_pattern();
+            pattern.set_zero();
+            double *values = pattern.values();
+            pattern.for_each_face([&](int f) {
+                for (int i = 0; i < 3; i++) {
+                    for (int j = 0; j < 3; j++) {
+                        double w = grad(f, i) * grad(f, j) + grad(f, 3 + i) * grad(f, 3 + j);
+                        values[pattern.slot(F, f, i, j)] -= area(f) * w;
+                    }
+                }
+            });
+            L_cot = pattern.matrix();
+        }
+        return L_cot;
+    }
+
+    // graph laplacian with unit edge weights, assembled on first use
+    const Eigen::SparseMatrix<double> &uniform_laplacian()
+    {
+        if (L_uniform.rows() == 0) {
+            // the off diagonal entries of the face pattern are the edges
+            build_pattern();
+            L_uniform = pattern.matrix();
+            #pragma omp parallel for
+            for (int k = 0; k < (int)L_uniform.outerSize(); k++) {
+                double degree = 0.0;
+                for (Eigen::SparseMatrix<double>::InnerIterator it(L_uniform, k); it; ++it) {
+                    if (it.row() != it.col()) {
+                        it.valueRef() = 1.0;
+                        degree += 1.0;
+                    }
+                }
+                L_uniform.valuePtr()[pattern.diagonal(k)] = -degree;
+            }
+        }
+        return L_uniform;
+    }
+
+    // the solvers only need area and grad: frees the laplacians and their
+    // pattern once the initialization is done
+    void release_laplacians()
+    {
+        pattern = CsrAssembly();
+        L_cot = Eigen::SparseMatrix<double>();
+        L_uniform = Eigen::SparseMatrix<double>();
+    }
+
+    // frees everything, num_vertices is 0 again
+    void clear()
+    {
+        release_laplacians();
+        area = Eigen::VectorXd();
+        grad = FaceGradients();
+        num_vertices = 0;
+        new (&F) FaceView(nullptr, 0, 3, Eigen::OuterStride<>(0));
+    }
+
+private:
+    // shared by both laplacians
+    void build_pattern()
+    {
+        if (pattern.empty()) {
+            pattern.build(F, 1, num_vertices, num_vertices, [](int, int v) { return v; });
+        }
+    }
+
+    FaceView F = FaceView(nullptr, 0, 3, Eigen::OuterStride<>(0));
+    CsrAssembly pattern;
+    Eigen::SparseMatrix<double> L_cot;
+    Eigen::SparseMatrix<double> L_uniform;
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+// Validation of input meshes before solving. One parallel pass builds an edge
+// table (half edges bucketed by their smaller vertex), a second pass over the
+// buckets classifies every edge; components, Euler characteristic, boundary
+// loops, manifoldness and degenerate faces all come from that table.
+//
+// Every tool validates its input by default; PARAM_NO_VALIDATE=1 skips it.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+
+struct MeshReport {
+    int num_vertices = 0;       // referenced by some face
+    int num_faces = 0;
+    int num_edges = 0;
+    int invalid_faces = 0;      // out of range or repeated vertex indices
+    int degenerate_faces = 0;   // (almost) zero area
+    int unreferenced_vertices = 0;
+    int boundary_edges = 0;
+    int non_manifold_edges = 0; // shared by more than two faces
+    int non_manifold_vertices = 0; // boundary vertices where several boundary loops meet
+    int inconsistent_edges = 0; // interior edges traversed twice in the same direction
+    int boundary_loops = 0;
+    int components = 0;
+    int euler_characteristic = 0;
+
+    bool is_manifold() const { return non_manifold_edges == 0 && non_manifold_vertices == 0; }
+    bool is_disk() const { return components == 1 && euler_characteristic == 1 && boundary_loops == 1; }
+};
+
+struct MeshRequirements {
+    bool single_component = true;
+    bool manifold = true;
+    bool oriented = true;
+    bool non_degenerate = true;
+    bool disk = false;          // one component, one boundary loop, euler characteristic 1
+    bool boundary = false;      // at least one boundary loop
+};
+
+
+namespace validation {
+
+// union-find with path halving
+struct DisjointSets {
+    std::vector<int> parent;
+    explicit DisjointSets(int n) : parent(n) { std::iota(parent.begin(), parent.end(), 0); }
+    int find(int i)
+    {
+        while (parent[i] != i) i = parent[i] = parent[parent[i]];
+        return i;
+    }
+    void unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+};
+
+// half edge a -> b of face f, bucketed by min(a, b)
+struct HalfEdge {
+    int other;  // max(a, b)
+    bool forward; // a < b
+    bool operator<(const HalfEdge &h) const { return other < h.other; }
+};
+
+} // namespace validation
+
+
+inline MeshReport validate_mesh(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F)
+{
+    using namespace validation;
+    TRACE_SCOPE("validate");
+
+    const int nv = V.rows();
+    const int nf = F.rows();
+    MeshReport report;
+    report.num_faces = nf;
+    if (nf == 0 || F.cols() != 3) return report;
+
+    // pass 1: face checks and bucket sizes
+    double diag2 = V.rows() > 0 ? (V.colwise().maxCoeff() - V.colwise().minCoeff()).squaredNorm() : 0.0;
+    const double eps = 1e-14 * diag2;
+    std::vector<int> offset(nv + 1, 0);
+    int invalid = 0, degenerate = 0;
+    #pragma omp parallel for reduction(+:invalid,degenerate)
+    for (int f = 0; f < nf; f++) {
+        int a = F(f, 0), b = F(f, 1), c = F(f, 2);
+        if (a < 0 || b < 0 || c < 0 || a >= nv || b >= nv || c >= nv || a == b || b == c || a == c) {
+            invalid++;
+            continue;
+        }
+        Eigen::Vector3d e1 = (V.row(b) - V.row(a)).head<3>().transpose();
+        Eigen::Vector3d e2 = (V.row(c) - V.row(a)).head<3>().transpose();
+        double dblA = std::sqrt(std::pow(e1.y() * e2.z() - e1.z() * e2.y(), 2) +
+                                std::pow(e1.z() * e2.x() - e1.x() * e2.z(), 2) +
+                                std::pow(e1.x() * e2.y() - e1.y() * e2.x(), 2));
+        if (!(dblA > eps)) degenerate++;
+        for (int i = 0; i < 3; i++) {
+            int lo = std::min(F(f, i), F(f, (i + 1) % 3));
+            #pragma omp atomic
+            offset[lo + 1]++;
+        }
+    }
+    report.invalid_faces = invalid;
+    report.degenerate_faces = degenerate;
+    if (invalid > 0) return report;
+
+    for (int v = 0; v < nv; v++) offset[v + 1] += offset[v];
+    std::vector<HalfEdge> table(offset[nv]);
+    std::vector<int> cursor(offset.begin(), offset.end() - 1);
+    for (int f = 0; f < nf; f++) {
+        for (int i = 0; i < 3; i++) {
+            int a = F(f, i), b = F(f, (i + 1) % 3);
+            int lo = std::min(a, b);
+            table[cursor[lo]++] = HalfEdge{std::max(a, b), a < b};
+        }
+    }
+
+    // pass 2: classify the edges of every bucket
+    std::vector<int> boundary_degree(nv, 0);
+    std::vector<char> referenced(nv, 0);
+    int edges = 0, boundary = 0, non_manifold = 0, inconsistent = 0;
+    #pragma omp parallel for reduction(+:edges,boundary,non_manifold,inconsistent) schedule(dynamic, 1024)
+    for (int v = 0; v < nv; v++) {
+        std::sort(table.begin() + offset[v], table.begin() + offset[v + 1]);
+        for (int i = offset[v]; i < offset[v + 1];) {
+            int j = i;
+            while (j < offset[v + 1] && table[j].other == table[i].other) j++;
+            int uses = j - i;
+            edges++;
+            if (uses == 1) {
+                boundary++;
+                #pragma omp atomic
+                boundary_degree[v]++;
+                #pragma omp atomic
+                boundary_degree[table[i].other]++;
+            } else if (uses == 2) {
+                inconsistent += table[i].forward == table[i + 1].forward;
+            } else {
+                non_manifold++;
+            }
+            i = j;
+        }
+    }
+    report.num_edges = edges;
+    report.boundary_edges = boundary;
+    report.non_manifold_edges = non_manifold;
+    report.inconsistent_edges = inconsistent;
+
+    // components over the face corners and boundary loops over the boundary edges
+    DisjointSets components(nv), loops(nv);
+    for (int f = 0; f < nf; f++) {
+        referenced[F(f, 0)] = referenced[F(f, 1)] = referenced[F(f, 2)] = 1;
+        components.unite(F(f, 0), F(f, 1));
+        components.unite(F(f, 0), F(f, 2));
+    }
+    for (int v = 0; v < nv; v++) {
+        for (int i = offset[v]; i < offset[v + 1]; i++) {
+            bool single = (i == offset[v] || table[i - 1].other != table[i].other) &&
+                          (i + 1 == offset[v + 1] || table[i + 1].other != table[i].other);
+            if (single) loops.unite(v, table[i].other);
+        }
+    }
+
+    for (int v = 0; v < nv; v++) {
+        if (!referenced[v]) {
+            report.unreferenced_vertices++;
+            continue;
+        }
+        report.num_vertices++;
+        if (components.find(v) == v) report.components++;
+        if (boundary_degree[v] > 0 && loops.find(v) == v) report.boundary_loops++;
+        if (boundary_degree[v] > 2) report.non_manifold_vertices++;
+    }
+    report.euler_characteristic = report.num_vertices - report.num_edges + report.num_faces;
+    return report;
+}
+
+// prints a diagnosis of every violated requirement, returns false if any
+inline bool check_mesh(const MeshReport &r, const MeshRequirements &req, const std::string &name = "Input")
+{
+    if (std::getenv("PARAM_NO_VALIDATE") != NULL) return true;
+
+    bool ok = true;
+    auto fail = [&](const std::string &msg) {
+        std::cerr << "Error! " << name << " " << msg << std::endl;
+        ok = false;
+    };
+
+    if (r.num_faces == 0) {
+        fail("has no faces (the file could not be read or the mesh is not manifold)");
+        return false;
+    }
+    if (r.invalid_faces > 0) {
+        fail("has " + std::to_string(r.invalid_faces) + " faces with invalid or repeated vertex indices");
+        return false;
+    }
+    if (req.non_degenerate && r.degenerate_faces > 0)
+        fail("has " + std::to_string(r.degenerate_faces) + " zero area faces");
+    if (req.manifold && r.non_manifold_edges > 0)
+        fail("is not edge manifold: " + std::to_string(r.non_manifold_edges) + " edges are shared by more than two faces");
+    if (req.manifold && r.non_manifold_vertices > 0)
+        fail("is not vertex manifold: " + std::to_string(r.non_manifold_vertices) + " vertices join several boundary loops");
+    if (req.oriented && r.inconsistent_edges > 0)
+        fail("is not consistently oriented: " + std::to_string(r.inconsistent_edges) + " edges are traversed twice in the same direction");
+    if (req.single_component && r.components != 1)
+        fail("has " + std::to_string(r.components) + " connected components");
+    if (req.boundary && r.boundary_loops == 0)
+        fail("has no boundary");
+    if (req.disk && !r.is_disk())
+        fail("does not have a disk topology: euler characteristic " + std::to_string(r.euler_characteristic) +
+             ", " + std::to_string(r.boundary_loops) + " boundary loops");
+
+    if (r.unreferenced_vertices > 0)
+        std::cerr << "Warning: " << name << " has " << r.unreferenced_vertices << " unreferenced vertices" << std::endl;
+    return ok;
+}
+
+inline bool check_mesh(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F, const MeshRequirements &req,
+                       const std::string &name = "Input")
+{
+    if (std::getenv("PARAM_NO_VALIDATE") != NULL) return true;
+    return check_mesh(validate_mesh(V, F), req, name);
+}
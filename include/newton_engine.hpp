@@ -0,0 +1,161 @@
+#pragma once
+
+// Projected Newton solver for the symmetric Dirichlet energy, sharing the
+// energy, the jacobians and the flip-free line search of SlimEngine. Each
+// face contributes its 6x6 hessian with negative eigenvalues clamped, so the
+// assembled matrix is positive (semi-)definite. The sparsity pattern is fixed:
+// it is built once with the per face scatter map of csr_assembly.hpp, filled
+// in parallel, and its symbolic factorization is reused.
+// Converges quadratically near the optimum, where SLIM slows down.
+
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "slim_engine.hpp"
+
+
+// value, gradient and hessian of psi(J) = |J|^2 + |J^-1|^2 w.r.t. j = (J00, J01, J10, J11)
+inline double symmetric_dirichlet_hessian(const Eigen::Matrix2d &J, Eigen::Vector4d &grad, Eigen::Matrix4d &hess)
+{
+    Eigen::Vector4d j(J(0, 0), J(0, 1), J(1, 0), J(1, 1));
+    double det = J.determinant();
+    double norm2 = j.squaredNorm();
+    double q = 1.0 / (det * det);
+
+    Eigen::Vector4d g_det(J(1, 1), -J(1, 0), -J(0, 1), J(0, 0));
+    Eigen::Matrix4d h_det = Eigen::Matrix4d::Zero();
+    h_det(0, 3) = h_det(3, 0) = 1.0;
+    h_det(1, 2) = h_det(2, 1) = -1.0;
+
+    Eigen::Vector4d g_q = -2.0 * q / det * g_det;
+    Eigen::Matrix4d h_q = 6.0 * q * q * g_det * g_det.transpose() - 2.0 * q / det * h_det;
+
+    grad = 2.0 * (1.0 + q) * j + norm2 * g_q;
+    hess = 2.0 * (1.0 + q) * Eigen::Matrix4d::Identity() + 2.0 * (j * g_q.transpose() + g_q * j.transpose()) + norm2 * h_q;
+    return norm2 * (1.0 + q);
+}
+
+// clamps the negative eigenvalues of a symmetric matrix to zero
+inline Eigen::Matrix4d project_psd(const Eigen::Matrix4d &H)
+{
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> eig(H);
+    Eigen::Vector4d lambda = eig.eigenvalues().cwiseMax(0.0);
+    return eig.eigenvectors() * lambda.asDiagonal() * eig.eigenvectors().transpose();
+}
+
+
+class NewtonEngine : public SlimEngine<double> {
+public:
+    // stop when the predicted decrease falls below this fraction of the energy
+    double tolerance = 1e-12;
+
+    // one projected Newton step with the flip-avoiding line search. Returns
+    // false once converged, or if no further progress is possible.
+    bool iterate()
+    {
+        if (!analyzed) {
+            hessian.build(F, 2, n, 2 * n, [this](int b, int v) { return b * n + v; });
+        }
+
+        Eigen::VectorXd x = iterate_as_double();
+        Eigen::VectorXd g;
+        assemble(x, g);
+
+        const SpMat &H = hessian.matrix();
+        if (!analyzed) {
+            solver.analyzePattern(H);
+            analyzed = true;
+        }
+        solver.factorize(H);
+        if (solver.info() != Eigen::Success) return false;
+        Eigen::VectorXd d = solver.solve(-g);
+
+        // newton decrement
+        double decrease = -0.5 * g.dot(d);
+        if (!(decrease > tolerance * energy * mesh_area)) return false;
+
+        double before = energy;
+        if (!line_search(x, x + d)) return false;
+        return energy < before;
+    }
+
+    int solve(int iterations)
+    {
+        for (int it = 0; it < iterations; it++) {
+            if (!iterate()) return it;
+        }
+        return iterations;
+    }
+
+protected:
+    int dof(int f, int r) const { return r < 3 ? F(f, r) : n + F(f, r - 3); }
+
+    // projected hessian and gradient at x, fixed dofs eliminated
+    void assemble(const Eigen::VectorXd &x, Eigen::VectorXd &g)
+    {
+        const double *u = x.data(), *v = x.data() + n;
+        hessian.set_zero();
+        double *values = hessian.values();
+        g.setZero(2 * n);
+
+        hessian.for_each_face([&](int f) {
+            Eigen::Matrix2d J = jacobian(f, u, v);
+            Eigen::Vector4d gj;
+            Eigen::Matrix4d hj;
+            symmetric_dirichlet_hessian(J, gj, hj);
+            hj = project_psd(hj);
+
+            // dj/d(u0 u1 u2 v0 v1 v2)
+            Eigen::Matrix<double, 4, 6> D = Eigen::Matrix<double, 4, 6>::Zero();
+            for (int i = 0; i < 3; i++) {
+                D(0, i) = D(2, 3 + i) = grad(f, i);
+                D(1, i) = D(3, 3 + i) = grad(f, 3 + i);
+            }
+            double A = area(f);
+            Eigen::Matrix<double, 6, 1> gf = A * D.transpose() * gj;
+            Eigen::Matrix<double, 6, 6> hf = A * D.transpose() * hj * D;
+
+            for (int r = 0; r < 6; r++) g(dof(f, r)) += gf(r);
+            for (int c = 0; c < 6; c++) {
+                for (int r = 0; r < 6; r++) values[hessian.slot(F, f, r, c)] += hf(r, c);
+            }
+        });
+
+        // soft constraints
+        if (!hard_constraints()) {
+            for (int i = 0; i < b.size(); i++) {
+                for (int k = 0; k < 2; k++) {
+                    int d = k * n + b(i);
+                    values[hessian.diagonal(d)] += 2.0 * soft_const_p;
+                    g(d) += 2.0 * soft_const_p * (x(d) - bc(i, k));
+                }
+            }
+        }
+
+        // tiny shift: translations are in the null space when nothing is pinned
+        double shift = 0.0;
+        for (int i = 0; i < 2 * n; i++) shift = std::max(shift, std::abs(values[hessian.diagonal(i)]));
+        shift *= 1e-10;
+        for (int i = 0; i < 2 * n; i++) values[hessian.diagonal(i)] += shift;
+
+        // eliminated dofs: identity rows and columns, zero gradient
+        if (hard_constraints()) {
+            const SpMat &H = hessian.matrix();
+            for (int col = 0; col < 2 * n; col++) {
+                for (int k = H.outerIndexPtr()[col]; k < H.outerIndexPtr()[col + 1]; k++) {
+                    int row = H.innerIndexPtr()[k];
+                    if (free_index[row] < 0 || free_index[col] < 0) values[k] = row == col ? 1.0 : 0.0;
+                }
+                if (free_index[col] < 0) g(col) = 0.0;
+            }
+        }
+    }
+
+    CsrAssembly hessian;        // 2n x 2n, fixed dofs kept as identity rows
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+// OBJ output of a mesh with texture coordinates, shared by the SLIM tools.
+// Written with full double precision through AtomicOutput, so a killed run
+// never leaves a partial file behind.
+
+#include <Eigen/Core>
+
+#include <cstdio>
+#include <string>
+
+#include "atomic_output.hpp"
+
+
+// TC, FTC: texture coordinates and their faces (FTC = F for per vertex uvs);
+// empty TC writes the geometry only
+inline bool writeOBJ(const std::string &str,
+                     const Eigen::Ref<const Eigen::MatrixXd> &V,
+                     const Eigen::Ref<const Eigen::MatrixXi> &F,
+                     const Eigen::Ref<const Eigen::MatrixXd> &TC,
+                     const Eigen::Ref<const Eigen::MatrixXi> &FTC)
+{
+    AtomicOutput output(str);
+    FILE *obj_file = fopen(output.temp_path().c_str(), "w");
+    if (NULL == obj_file) {
+        printf("IOError: %s could not be opened for writing...", str.c_str());
+        return false;
+    }
+    // Loop over V
+    for (int i = 0; i < (int)V.rows(); i++) {
+        fprintf(obj_file, "v");
+        for (int j = 0; j < (int)V.cols(); ++j) {
+            fprintf(obj_file, " %0.17g", V(i, j));
+        }
+        fprintf(obj_file, "\n");
+    }
+
+    bool write_texture_coords = TC.rows() > 0;
+    if (write_texture_coords) {
+        for (int i = 0; i < (int)TC.rows(); i++) {
+            fprintf(obj_file, "vt %0.17g %0.17g\n", TC(i, 0), TC(i, 1));
+        }
+        fprintf(obj_file, "\n");
+    }
+
+    // loop over F
+    for (int i = 0; i < (int)F.rows(); ++i) {
+        fprintf(obj_file, "f");
+        for (int j = 0; j < (int)F.cols(); ++j) {
+            // OBJ is 1-indexed
+            fprintf(obj_file, " %u", F(i, j) + 1);
+            if (write_texture_coords) fprintf(obj_file, "/%u", FTC(i, j) + 1);
+        }
+        fprintf(obj_file, "\n");
+    }
+    return output.commit(AtomicOutput::close(obj_file));
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+// Reads an OFF file straight into the V/F arrays the library takes, sized
+// from the counts in the header, without building a CGAL mesh first. The
+// library builds the one CGAL mesh it needs from the arrays.
+//
+// Colors or normals after the coordinates and the face indices are skipped
+// (COFF, NOFF, ...). Faces that are not triangles become rows of -1 so that
+// validation rejects them. Binary OFF is not read.
+
+#include <Eigen/Core>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace off_input {
+
+// past blanks, line ends and comments
+inline const char *skip_space(const char *p)
+{
+    for (;;) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+        if (*p != '#') return p;
+        while (*p != '\0' && *p != '\n') p++;
+    }
+}
+
+inline const char *skip_line(const char *p)
+{
+    while (*p != '\0' && *p != '\n') p++;
+    return p;
+}
+
+inline bool read_long(const char *&p, long &value)
+{
+    char *end;
+    value = std::strtol(skip_space(p), &end, 10);
+    if (end == skip_space(p)) return false;
+    p = end;
+    return true;
+}
+
+inline bool read_double(const char *&p, double &value)
+{
+    char *end;
+    value = std::strtod(skip_space(p), &end);
+    if (end == skip_space(p)) return false;
+    p = end;
+    return true;
+}
+
+} // namespace off_input
+
+
+inline bool read_off(const std::string &path, Eigen::MatrixXd &V, Eigen::MatrixXi &F)
+{
+    using namespace off_input;
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    std::vector<char> text;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+        long size = std::ftell(file);
+        if (size > 0) text.resize(size);
+        std::rewind(file);
+    }
+    bool ok = text.empty() || std::fread(text.data(), 1, text.size(), file) == text.size();
+    std::fclose(file);
+    if (!ok) return false;
+    text.push_back('\0');
+
+    // [ST][C][N]OFF keyword, then the vertex, face and edge counts
+    const char *p = skip_space(text.data());
+    const char *word = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+    const std::string keyword(word, p);
+    if (keyword.size() < 3 || keyword.compare(keyword.size() - 3, 3, "OFF") != 0) {
+        p = word;  // the keyword is optional
+    } else if (std::strncmp(skip_space(p), "BINARY", 6) == 0) {
+        return false;
+    }
+    long nv, nf, ne;
+    if (!read_long(p, nv) || !read_long(p, nf) || !read_long(p, ne) || nv < 0 || nf < 0) return false;
+    // every element takes at least a few characters, counts beyond the file
+    // are rejected before allocating them
+    if ((std::size_t)(nv + nf) > text.size()) return false;
+
+    V.resize(nv, 3);
+    for (long v = 0; v < nv; v++) {
+        for (int k = 0; k < 3; k++) {
+            if (!read_double(p, V(v, k))) return false;
+        }
+        p = skip_line(p);
+    }
+    F.resize(nf, 3);
+    for (long f = 0; f < nf; f++) {
+        long n, index;
+        if (!read_long(p, n) || n < 0) return false;
+        F.row(f).setConstant(-1);
+        for (long k = 0; k < n; k++) {
+            if (!read_long(p, index) || index < 0 || index >= nv) return false;
+            if (n == 3) F(f, k) = index;
+        }
+        p = skip_line(p);
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// Minimal command line handling shared by the tools: "--name value" or
+// "--name=value" for the flags declared as taking a value, "--name" for
+// the declared switches, everything else is kept in order as a positional
+// argument. Any other flag is an error, see check().
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+
+class Options {
+public:
+    Options(int argc, char **argv, const std::set<std::string> &valued = std::set<std::string>(),
+            const std::set<std::string> &switches = std::set<std::string>())
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string arg(argv[i]);
+            if (arg.size() < 3 || arg.compare(0, 2, "--") != 0) {
+                positional.push_back(arg);
+                continue;
+            }
+            std::string name = arg.substr(2);
+            std::size_t eq = name.find('=');
+            const std::string key = name.substr(0, eq);
+            if (!valued.count(key) && !switches.count(key)) {
+                unknown.push_back(arg);
+            } else if (eq != std::string::npos) {
+                flags[key] = name.substr(eq + 1);
+            } else if (valued.count(name) && i + 1 < argc) {
+                flags[name] = argv[++i];
+            } else {
+                flags[name] = "";
+            }
+        }
+    }
+
+    // false, after printing the unknown flags and the usage, if the command
+    // line has a flag the tool did not declare
+    bool check(const std::string &usage) const
+    {
+        for (const std::string &arg : unknown) std::cerr << "Error! Unknown option " << arg << std::endl;
+        if (!unknown.empty()) std::cerr << usage << std::endl;
+        return unknown.empty();
+    }
+
+    std::size_t size() const { return positional.size(); }
+    const std::string &operator[](std::size_t i) const { return positional[i]; }
+
+    bool has(const std::string &name) const { return flags.count(name) > 0; }
+
+    std::string get(const std::string &name, const std::string &fallback) const
+    {
+        auto it = flags.find(name);
+        return it == flags.end() ? fallback : it->second;
+    }
+
+    int get_int(const std::string &name, int fallback) const
+    {
+        auto it = flags.find(name);
+        return it == flags.end() || it->second.empty() ? fallback : std::atoi(it->second.c_str());
+    }
+
+    double get_double(const std::string &name, double fallback) const
+    {
+        auto it = flags.find(name);
+        return it == flags.end() || it->second.empty() ? fallback : std::atof(it->second.c_str());
+    }
+
+    std::vector<std::string> positional;
+    std::map<std::string, std::string> flags;
+    std::vector<std::string> unknown;
+};
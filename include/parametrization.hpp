@@ -0,0 +1,160 @@
+#pragma once
+
+// Headless entry points of the tools, for programs that embed the
+// parametrization instead of running the executables; the tools themselves
+// only read their files, call these functions and write the results. Inputs
+// are Eigen::Ref views, so Eigen::Map views of caller owned buffers (column
+// major, Eigen's default: all x, then all y, ...) are read in place; nothing
+// is read from or written to disk, except the SLIM checkpoints when
+// SlimOptions::checkpoint is set. Fixed size results are written into caller
+// owned buffers, variable size results are filled in the given matrices.
+//
+// Every function validates its input like the corresponding tool and returns
+// false, after a message on std::cerr, if the input or the solve fails.
+// Indices in inputs and outputs always refer to the input order, also when
+// the solve runs reordered (`reorder`: "rcm" or "morton", see reorder.hpp).
+// Link with the `parametrization` library target.
+
+#include <Eigen/Core>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace parametrization {
+
+typedef Eigen::Ref<const Eigen::MatrixXd> ConstPoints;     // n x 3 positions, n x 2 uvs
+typedef Eigen::Ref<const Eigen::MatrixXi> ConstIndices;    // m x 3 faces, k x 2 vertex pairs
+typedef Eigen::Ref<Eigen::MatrixXd> Points;                // caller owned output
+
+// `tutte`: barycentric map of a disk with its longest border on the square
+// [-1, 1]^2. corners: optional 4 vertex indices for the square corners.
+// uv: V.rows() x 2. null_faces: optional, the faces collapsed to zero area.
+bool tutte(const ConstPoints &V, const ConstIndices &F, Points uv, const int *corners = nullptr,
+           const std::string &reorder = "", int *null_faces = nullptr);
+
+struct SlimOptions {
+    int iterations = 100;
+    // true: the boundary keeps the uv given on input (`slim_bnd`), or is
+    // mapped to the unit circle if circle_boundary is set (`slim`); the
+    // interior starts from the harmonic map.
+    // false: `freeslim`, the boundary moves; the solve starts from the uv
+    // given on input if use_input is set, otherwise from the `init` map.
+    bool fixed_boundary = true;
+    bool circle_boundary = false;
+    bool use_input = false;
+    std::string init = "harmonic";  // or "conformal", see conformal_init.hpp
+    // > 1: partition-and-stitch solve over that many patches, see
+    // partitioned_slim.hpp. It always eliminates a fixed boundary (libigl is
+    // ignored) and cannot be combined with the newton engine,
+    // single_precision or resume.
+    int partitions = 1;
+    // "slim", "newton" (see newton_engine.hpp) or "slim+newton", which
+    // polishes the SLIM result with up to newton_iterations Newton iterations
+    std::string engine = "slim";
+    int newton_iterations = 50;
+    // SLIM iterations on igl::slim, with a fixed boundary held by a 1e35
+    // penalty (the tools without --hard-bnd), instead of the in-tree engine
+    // that eliminates it from the system
+    bool libigl = false;
+    // float32 solver state, see run_slim_single_precision
+    bool single_precision = false;
+    std::string reorder;
+    // the solver state is saved to this file every checkpoint_every
+    // iterations and when the run budget stops the solve (see
+    // run_budget.hpp); resume continues from it if it belongs to this mesh
+    // and settings. The caller removes it once the result is written.
+    std::string checkpoint;
+    int checkpoint_every = 50;
+    bool resume = false;
+};
+
+struct SlimResult {
+    double energy = 0.0;
+    int flips = 0;
+    int first_iteration = 0;    // > 0 when resumed from a checkpoint
+    int iterations = 0;         // iteration reached, < SlimOptions::iterations if the solve stopped early
+};
+
+// SLIM on the symmetric Dirichlet energy of a disk. uv: V.rows() x 2, the
+// initial map on input (see SlimOptions) and the result on output.
+bool slim(const ConstPoints &V, const ConstIndices &F, Points uv, const SlimOptions &options, SlimResult &result);
+
+// energy, flips: optional outputs.
+bool slim(const ConstPoints &V, const ConstIndices &F, Points uv, const SlimOptions &options = SlimOptions(),
+          double *energy = nullptr, int *flips = nullptr);
+
+// `slim_bnd --previous`, `freeslim --previous`: re-solves only the part of
+// (V, F) that changed since a previous result (V_prev, F_prev with one uv per
+// vertex), see incremental.hpp. A fixed boundary keeps the previous uv, or the
+// uv given on input if options.use_input is set. uv: V.rows() x 2.
+bool slim_incremental(const ConstPoints &V, const ConstIndices &F,
+                      const ConstPoints &V_prev, const ConstIndices &F_prev, const ConstPoints &uv_prev,
+                      Points uv, const SlimOptions &options, int rings = 2, double *energy = nullptr);
+
+// next(V_frame): the positions of the next frame, false after the last one.
+// write(frame, V_frame, uv_frame): the result of frame 0, 1, ..., false if it
+// could not be stored, which stops the sequence.
+typedef std::function<bool(Eigen::MatrixXd &)> FrameSource;
+typedef std::function<bool(int, const Eigen::MatrixXd &, const Eigen::MatrixXd &)> FrameSink;
+
+// `slim_bnd --sequence`: the frames of an animation with the connectivity of
+// F, each solved with up to `iterations` iterations from the uv of the
+// previous one. uv: the result of slim on (V, F), whose boundary stays fixed.
+// Returns the number of frames solved and written, -1 on invalid input.
+int slim_sequence(const ConstPoints &V, const ConstIndices &F, const ConstPoints &uv, const SlimOptions &options,
+                  int iterations, FrameSource next, FrameSink write);
+
+// `dijkstra_seam`: shortest edge path for every (start, end) row of
+// endpoints. seams: the edges of all paths, one (vertex, vertex) row each,
+// every path from its end to its start.
+bool seam_paths(const ConstPoints &V, const ConstIndices &F, const ConstIndices &endpoints, Eigen::MatrixXi &seams,
+                const std::string &reorder = "");
+
+struct Chart {
+    Eigen::MatrixXd V;      // positions, seam vertices appear once per side
+    Eigen::MatrixXi F;      // one row per input face
+    Eigen::MatrixXd uv;     // per vertex of the chart, in [-1, 1]^2
+    Eigen::VectorXi vertex; // input vertex of every chart vertex
+
+    // distortion of the chart scaled to the surface area, see distortion.hpp
+    int flips = 0;
+    int degenerate = 0;
+    int null_faces = 0;     // zero area in uv
+    double symmetric_dirichlet = 0.0;
+    double conformal = 0.0;
+    double area = 0.0;
+};
+
+struct CutOptions {
+    // ARAP refinement of the Tutte map, see arap.hpp
+    bool arap = false;
+    int arap_iterations = 100;
+    double arap_tolerance = 1e-6;
+    // cut_candidates: "dirichlet", "conformal" or "area"
+    std::string rank = "dirichlet";
+};
+
+// `cut`: opens the mesh along the seam edges (k x 2 vertex pairs, e.g. from
+// seam_paths) and maps the result like tutte. Pairs that are not an inner
+// edge, or repeat one, are skipped with a warning.
+bool cut(const ConstPoints &V, const ConstIndices &F, const ConstIndices &seams, Chart &chart,
+         const CutOptions &options = CutOptions());
+
+// `cut` with several seam files: cuts along every set of seams, in parallel,
+// and ranks the charts by fewest flipped and degenerate faces, then lowest
+// options.rank. order: the candidates that could be parametrized, best
+// first; false if there is none.
+bool cut_candidates(const ConstPoints &V, const ConstIndices &F, const std::vector<Eigen::MatrixXi> &seams,
+                    std::vector<Chart> &charts, std::vector<int> &order, const CutOptions &options = CutOptions());
+
+// `geodesic`: exact geodesic distance between the surface points of every
+// row: a face and the barycentric coordinates of the point in it.
+// distances: sources.rows() entries, divided by sqrt(area) if normalize.
+bool geodesic_distances(const ConstPoints &V, const ConstIndices &F,
+                        const Eigen::Ref<const Eigen::VectorXi> &source_faces, const ConstPoints &source_bary,
+                        const Eigen::Ref<const Eigen::VectorXi> &target_faces, const ConstPoints &target_bary,
+                        Eigen::Ref<Eigen::VectorXd> distances, bool normalize = false, const std::string &reorder = "");
+
+} // namespace parametrization
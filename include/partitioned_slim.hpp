@@ -0,0 +1,275 @@
+#pragma once
+
+// Partition-and-stitch SLIM for meshes too large for one factorization.
+// The faces are split into balanced patches by recursive coordinate
+// bisection, and every patch is grown by a few rings of overlap. Each round:
+//   1. every patch runs a few SLIM iterations on its own (in parallel), with
+//      the vertices on its border pinned to the current map, and writes back
+//      the vertices it owns;
+//   2. the whole map moves towards the stitched result with the flip-free
+//      line search, so it stays injective, and one global SLIM iteration
+//      solved with AMG preconditioned CG propagates the correction across
+//      the patches.
+// There is one uv per vertex at all times, so the map is seamless by
+// construction. Direct factorizations only ever see one patch; the global
+// state is linear in the mesh size. A patch engine lives for one patch solve:
+// at most one per thread exists at a time, so the peak memory is that of the
+// global state and the largest patches being solved, whatever the number of
+// patches.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "run_budget.hpp"
+#include "slim_engine.hpp"
+#include "trace.hpp"
+
+
+namespace partition {
+
+// part of every face: recursive coordinate bisection of the face centroids
+// into `parts` parts of (almost) equal size
+inline std::vector<int> bisect_faces(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                                     int parts)
+{
+    const int nf = F.rows();
+    Eigen::MatrixXd C(nf, 3);
+    #pragma omp parallel for
+    for (int f = 0; f < nf; f++) {
+        C.row(f) = (V.row(F(f, 0)) + V.row(F(f, 1)) + V.row(F(f, 2))).head<3>() / 3.0;
+    }
+
+    std::vector<int> order(nf);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<int> part(nf, 0);
+
+    struct Range { int begin, end, parts, first; };
+    std::vector<Range> stack = { { 0, nf, parts, 0 } };
+    while (!stack.empty()) {
+        Range r = stack.back();
+        stack.pop_back();
+        if (r.parts <= 1 || r.end - r.begin < 2) {
+            for (int i = r.begin; i < r.end; i++) part[order[i]] = r.first;
+            continue;
+        }
+        Eigen::RowVector3d lo = C.row(order[r.begin]), hi = lo;
+        for (int i = r.begin + 1; i < r.end; i++) {
+            lo = lo.cwiseMin(C.row(order[i]));
+            hi = hi.cwiseMax(C.row(order[i]));
+        }
+        int axis;
+        (hi - lo).maxCoeff(&axis);
+        int left_parts = r.parts / 2;
+        int mid = r.begin + (int)((long long)(r.end - r.begin) * left_parts / r.parts);
+        std::nth_element(order.begin() + r.begin, order.begin() + mid, order.begin() + r.end,
+                         [&](int a, int b) { return C(a, axis) < C(b, axis); });
+        stack.push_back({ r.begin, mid, left_parts, r.first });
+        stack.push_back({ mid, r.end, r.parts - left_parts, r.first + left_parts });
+    }
+    return part;
+}
+
+struct Patch {
+    std::vector<int> vertices;  // local -> global
+    Eigen::MatrixXi F;          // local faces
+    std::vector<int> border;    // local vertices touched by faces of other patches
+    std::vector<int> pinned;    // local vertices constrained in the whole mesh
+    std::vector<int> pinned_row;// their row in bc
+    std::vector<int> owned;     // local vertices this patch writes back
+};
+
+// patches of faces with their part grown by `overlap` vertex rings; a vertex
+// is owned by the part of its first face
+inline std::vector<Patch> build_patches(const Eigen::Ref<const Eigen::MatrixXi> &F, int nv, const std::vector<int> &part, int parts,
+                                        int overlap, const Eigen::VectorXi &b)
+{
+    const int nf = F.rows();
+    // vertex -> faces
+    std::vector<int> vf_begin(nv + 1, 0), vf(3 * nf);
+    for (int f = 0; f < nf; f++)
+        for (int i = 0; i < 3; i++) vf_begin[F(f, i) + 1]++;
+    for (int v = 0; v < nv; v++) vf_begin[v + 1] += vf_begin[v];
+    {
+        std::vector<int> next(vf_begin.begin(), vf_begin.end() - 1);
+        for (int f = 0; f < nf; f++)
+            for (int i = 0; i < 3; i++) vf[next[F(f, i)]++] = f;
+    }
+    std::vector<int> owner(nv, -1);
+    for (int v = 0; v < nv; v++) {
+        if (vf_begin[v + 1] > vf_begin[v]) owner[v] = part[vf[vf_begin[v]]];
+    }
+    std::vector<int> pinned_row(nv, -1);
+    for (int i = 0; i < b.size(); i++) pinned_row[b(i)] = i;
+    // faces by part
+    std::vector<int> part_begin(parts + 1, 0), part_faces(nf);
+    for (int f = 0; f < nf; f++) part_begin[part[f] + 1]++;
+    for (int p = 0; p < parts; p++) part_begin[p + 1] += part_begin[p];
+    {
+        std::vector<int> next(part_begin.begin(), part_begin.end() - 1);
+        for (int f = 0; f < nf; f++) part_faces[next[part[f]]++] = f;
+    }
+
+    std::vector<Patch> patches(parts);
+    #pragma omp parallel
+    {
+        std::vector<char> in_patch(nf, 0);
+        std::vector<int> local(nv, -1);
+        #pragma omp for schedule(dynamic, 1)
+        for (int p = 0; p < parts; p++) {
+            std::vector<int> faces(part_faces.begin() + part_begin[p], part_faces.begin() + part_begin[p + 1]);
+            for (int f : faces) in_patch[f] = 1;
+            // grow by vertex rings
+            for (int ring = 0; ring < overlap; ring++) {
+                std::size_t count = faces.size();
+                for (std::size_t k = 0; k < count; k++) {
+                    for (int i = 0; i < 3; i++) {
+                        int v = F(faces[k], i);
+                        for (int j = vf_begin[v]; j < vf_begin[v + 1]; j++) {
+                            if (!in_patch[vf[j]]) {
+                                in_patch[vf[j]] = 1;
+                                faces.push_back(vf[j]);
+                            }
+                        }
+                    }
+                }
+            }
+
+            Patch &patch = patches[p];
+            patch.F.resize(faces.size(), 3);
+            for (std::size_t k = 0; k < faces.size(); k++) {
+                for (int i = 0; i < 3; i++) {
+                    int v = F(faces[k], i);
+                    if (local[v] < 0) {
+                        local[v] = patch.vertices.size();
+                        patch.vertices.push_back(v);
+                    }
+                    patch.F(k, i) = local[v];
+                }
+            }
+            for (int l = 0; l < (int)patch.vertices.size(); l++) {
+                int v = patch.vertices[l];
+                bool border = false;
+                for (int j = vf_begin[v]; j < vf_begin[v + 1] && !border; j++) border = !in_patch[vf[j]];
+                if (border) {
+                    patch.border.push_back(l);
+                } else if (pinned_row[v] >= 0) {
+                    patch.pinned.push_back(l);
+                    patch.pinned_row.push_back(pinned_row[v]);
+                }
+                if (owner[v] == p && !border) patch.owned.push_back(l);
+            }
+
+            for (int f : faces) in_patch[f] = 0;
+            for (int v : patch.vertices) local[v] = -1;
+        }
+    }
+    return patches;
+}
+
+} // namespace partition
+
+
+// Runs `iterations` SLIM iterations worth of rounds (patch_iterations patch
+// iterations each) over `parts` patches. b / bc / soft_const_p as for
+// SlimEngine::precompute; the patch borders are always hard constraints.
+// Returns the iterations reached, fewer if the run budget ran out.
+inline int partitioned_slim(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                            const Eigen::Ref<const Eigen::MatrixXd> &uv_init,
+                            const Eigen::VectorXi &b, const Eigen::Ref<const Eigen::MatrixXd> &bc, double soft_const_p,
+                            int parts, int iterations, Eigen::MatrixXd &uv, double &energy,
+                            int overlap = 2, int patch_iterations = 5)
+{
+    using namespace partition;
+    TRACE_SCOPE("partitioned_slim");
+    overlap = std::max(overlap, 1);   // owned vertices must not sit on a patch border
+
+    std::vector<Patch> patches;
+    {
+        TRACE_SCOPE("partition");
+        patches = build_patches(F, V.rows(), bisect_faces(V, F, parts), parts, overlap, b);
+    }
+    std::size_t largest = 0;
+    for (const Patch &patch : patches) largest = std::max(largest, (std::size_t)patch.F.rows());
+    std::cout << parts << " patches, largest " << largest << " faces" << std::endl;
+    trace::counter("patch_faces", largest);
+
+    // the whole map: linear memory only
+    SlimEngine<double> global;
+    global.iterative = true;
+    global.precompute(V, F, uv_init, b, bc, soft_const_p);
+    std::cout << "energy = " << global.energy << std::endl;
+    const bool hard = global.hard_constraints();
+
+    // patch border and pinned vertices: local vertex and, for the pinned
+    // ones, their row in bc (-1 for the border, which follows the map)
+    std::vector<std::vector<int>> constrained(patches.size()), constrained_row(patches.size());
+    for (std::size_t p = 0; p < patches.size(); p++) {
+        const Patch &patch = patches[p];
+        constrained[p] = patch.border;
+        constrained_row[p].assign(patch.border.size(), -1);
+        // soft global constraints are left to the global correction
+        for (std::size_t i = 0; hard && i < patch.pinned.size(); i++) {
+            constrained[p].push_back(patch.pinned[i]);
+            constrained_row[p].push_back(patch.pinned_row[i]);
+        }
+    }
+
+    RunBudget &budget = run_budget();
+    int reached = 0;
+    double slowest = 0.0;
+    while (reached < iterations && !budget.should_stop(slowest)) {
+        TRACE_SCOPE("round");
+        auto start = std::chrono::steady_clock::now();
+        const Eigen::MatrixXd x = global.uv();
+        Eigen::MatrixXd target = x;
+
+        {
+            TRACE_SCOPE("patches");
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int p = 0; p < (int)patches.size(); p++) {
+                const Patch &patch = patches[p];
+                const int np = patch.vertices.size();
+                Eigen::MatrixXd uvp(np, 2);
+                for (int l = 0; l < np; l++) uvp.row(l) = x.row(patch.vertices[l]);
+                const int nb = constrained[p].size();
+                Eigen::VectorXi bp(nb);
+                Eigen::MatrixXd bcp(nb, 2);
+                for (int k = 0; k < nb; k++) {
+                    bp(k) = constrained[p][k];
+                    int row = constrained_row[p][k];
+                    bcp.row(k) = row < 0 ? Eigen::RowVector2d(uvp.row(bp(k))) : Eigen::RowVector2d(bc.row(row).head<2>());
+                }
+
+                Eigen::MatrixXd Vp(np, 3);
+                for (int l = 0; l < np; l++) Vp.row(l) = V.row(patch.vertices[l]).head<3>();
+                SlimEngine<double> engine;
+                engine.precompute(Vp, patch.F, uvp, bp, bcp, 1e35);
+                engine.solve(patch_iterations);
+                Eigen::MatrixXd result = engine.uv();
+                for (int l : patch.owned) target.row(patch.vertices[l]) = result.row(l);
+            }
+        }
+
+        {
+            TRACE_SCOPE("correction");
+            global.step_towards(target);
+            global.iterate();
+        }
+        reached = std::min(iterations, reached + patch_iterations);
+        slowest = std::max(slowest, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        std::cout << "round " << reached / patch_iterations << ": energy = " << global.energy << std::endl;
+    }
+    if (budget.stopped()) {
+        std::cerr << "Warning: stopped at iteration " << reached << " (" << budget.reason() << ")" << std::endl;
+    }
+
+    uv = global.uv();
+    energy = global.energy;
+    return reached;
+}
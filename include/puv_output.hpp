@@ -0,0 +1,223 @@
+#pragma once
+
+// Compact binary output of a mesh with texture coordinates (.puv), written
+// next to the OBJ outputs of the tools with --binary-bits. Arrays are stored
+// contiguously, little endian:
+//   char     magic[4]          "PUV1"
+//   uint32   num_vertices, num_uvs, num_faces, bits, flags
+//   float64  uv_min[2], uv_max[2]
+//   float32  positions[num_vertices][3]
+//   uintN    uvs[num_uvs][2]            N = 16 if bits <= 16, 32 otherwise
+//   uint32   faces[num_faces][3]
+//   uint32   uv_faces[num_faces][3]     only if flags & PUV_UV_FACES
+// A uv coordinate is quantized per axis to round((u - uv_min) / (uv_max -
+// uv_min) * (2^bits - 1)); positions are rounded to single precision.
+// The file is written in one streaming pass through AtomicOutput.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "atomic_output.hpp"
+
+
+static const std::uint32_t PUV_UV_FACES = 1;   // uv faces differ from the faces
+
+// buffered fwrite of plain values
+class BinaryStream {
+public:
+    explicit BinaryStream(FILE *file) : file(file) { buffer.reserve(1 << 16); }
+
+    template <class T>
+    void put(T value)
+    {
+        if (buffer.size() + sizeof(T) > buffer.capacity()) flush();
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    bool flush()
+    {
+        ok = ok && fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        buffer.clear();
+        return ok;
+    }
+
+private:
+    FILE *file;
+    std::vector<char> buffer;
+    bool ok = true;
+};
+
+// TC, FTC: texture coordinates and their faces (FTC = F for per vertex uvs).
+// bits: 1 to 32 per uv coordinate. max_uv_error: optional, the largest
+// difference between a uv coordinate and its quantized value.
+inline bool writePUV(const std::string &str,
+                     const Eigen::Ref<const Eigen::MatrixXd> &V,
+                     const Eigen::Ref<const Eigen::MatrixXi> &F,
+                     const Eigen::Ref<const Eigen::MatrixXd> &TC,
+                     const Eigen::Ref<const Eigen::MatrixXi> &FTC,
+                     int bits, double *max_uv_error = nullptr)
+{
+    if (bits < 1 || bits > 32) {
+        std::cerr << "Error! --binary-bits must be between 1 and 32, got " << bits << std::endl;
+        return false;
+    }
+    if (V.cols() != 3 || F.cols() != 3 || TC.cols() < 2 || FTC.rows() != F.rows() || FTC.cols() != 3) {
+        std::cerr << "Error! Binary output needs a triangle mesh with per corner uvs" << std::endl;
+        return false;
+    }
+
+    AtomicOutput output(str);
+    FILE *puv_file = fopen(output.temp_path().c_str(), "wb");
+    if (NULL == puv_file) {
+        printf("IOError: %s could not be opened for writing...", str.c_str());
+        return false;
+    }
+
+    const bool uv_faces = FTC != F;
+    Eigen::RowVector2d lo(0.0, 0.0), hi(0.0, 0.0);
+    if (TC.rows() > 0) {
+        lo = TC.leftCols<2>().colwise().minCoeff();
+        hi = TC.leftCols<2>().colwise().maxCoeff();
+    }
+    const double levels = std::ldexp(1.0, bits) - 1.0;
+    double step[2], error = 0.0;
+    for (int k = 0; k < 2; k++) step[k] = hi(k) > lo(k) ? (hi(k) - lo(k)) / levels : 0.0;
+
+    BinaryStream out(puv_file);
+    for (char c : {'P', 'U', 'V', '1'}) out.put(c);
+    out.put<std::uint32_t>(V.rows());
+    out.put<std::uint32_t>(TC.rows());
+    out.put<std::uint32_t>(F.rows());
+    out.put<std::uint32_t>(bits);
+    out.put<std::uint32_t>(uv_faces ? PUV_UV_FACES : 0);
+    out.put(lo(0));
+    out.put(lo(1));
+    out.put(hi(0));
+    out.put(hi(1));
+
+    for (int i = 0; i < (int)V.rows(); i++) {
+        for (int j = 0; j < 3; j++) out.put((float)V(i, j));
+    }
+    for (int i = 0; i < (int)TC.rows(); i++) {
+        for (int k = 0; k < 2; k++) {
+            double q = step[k] > 0.0 ? std::round((TC(i, k) - lo(k)) / step[k]) : 0.0;
+            q = std::min(std::max(q, 0.0), levels);
+            error = std::max(error, std::abs(lo(k) + q * step[k] - TC(i, k)));
+            if (bits <= 16) out.put((std::uint16_t)q);
+            else out.put((std::uint32_t)q);
+        }
+    }
+    for (int i = 0; i < (int)F.rows(); i++) {
+        for (int j = 0; j < 3; j++) out.put((std::uint32_t)F(i, j));
+    }
+    for (int i = 0; uv_faces && i < (int)FTC.rows(); i++) {
+        for (int j = 0; j < 3; j++) out.put((std::uint32_t)FTC(i, j));
+    }
+
+    bool ok = out.flush();
+    ok = AtomicOutput::close(puv_file) && ok;
+    if (max_uv_error) *max_uv_error = error;
+    return output.commit(ok);
+}
+
+// reads a .puv back, with the uvs dequantized; FTC = F if the file has no
+// separate uv faces. Fails on a file whose size does not match its header or
+// whose faces index past the vertices.
+inline bool readPUV(const std::string &str, Eigen::MatrixXd &V, Eigen::MatrixXi &F,
+                    Eigen::MatrixXd &TC, Eigen::MatrixXi &FTC)
+{
+    FILE *puv_file = fopen(str.c_str(), "rb");
+    if (NULL == puv_file) {
+        printf("IOError: %s could not be opened...", str.c_str());
+        return false;
+    }
+    auto get = [puv_file](void *data, std::size_t size) { return fread(data, 1, size, puv_file) == size; };
+
+    char magic[4];
+    std::uint32_t header[5];
+    double lo[2], hi[2];
+    bool ok = get(magic, 4) && std::memcmp(magic, "PUV1", 4) == 0 && get(header, sizeof(header)) &&
+              get(lo, sizeof(lo)) && get(hi, sizeof(hi)) && header[3] >= 1 && header[3] <= 32;
+    if (ok) {
+        // the counts must account for the whole file before anything is
+        // allocated from them
+        const std::uint64_t uv_size = header[3] <= 16 ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+        const std::uint64_t expected = 4 + sizeof(header) + sizeof(lo) + sizeof(hi) +
+                                       (std::uint64_t)header[0] * 3 * sizeof(float) +
+                                       (std::uint64_t)header[1] * 2 * uv_size +
+                                       (std::uint64_t)header[2] * 3 * sizeof(std::uint32_t) *
+                                           ((header[4] & PUV_UV_FACES) ? 2 : 1);
+        long size = -1;
+        if (fseek(puv_file, 0, SEEK_END) == 0) size = ftell(puv_file);
+        ok = size >= 0 && (std::uint64_t)size == expected &&
+             fseek(puv_file, 4 + sizeof(header) + sizeof(lo) + sizeof(hi), SEEK_SET) == 0;
+    }
+    if (ok) {
+        const std::uint32_t nv = header[0], ntc = header[1], nf = header[2], bits = header[3];
+        std::vector<float> positions(3 * (std::size_t)nv);
+        ok = get(positions.data(), positions.size() * sizeof(float));
+        V.resize(nv, 3);
+        for (std::uint32_t i = 0; ok && i < nv; i++) {
+            for (int j = 0; j < 3; j++) V(i, j) = positions[3 * i + j];
+        }
+
+        const double levels = std::ldexp(1.0, bits) - 1.0;
+        std::vector<std::uint32_t> q(2 * (std::size_t)ntc);
+        if (bits <= 16) {
+            std::vector<std::uint16_t> q16(q.size());
+            ok = ok && get(q16.data(), q16.size() * sizeof(std::uint16_t));
+            std::copy(q16.begin(), q16.end(), q.begin());
+        } else {
+            ok = ok && get(q.data(), q.size() * sizeof(std::uint32_t));
+        }
+        TC.resize(ntc, 2);
+        for (std::uint32_t i = 0; ok && i < ntc; i++) {
+            for (int k = 0; k < 2; k++) TC(i, k) = lo[k] + q[2 * i + k] * ((hi[k] - lo[k]) / levels);
+        }
+
+        std::vector<std::uint32_t> faces(3 * (std::size_t)nf);
+        ok = ok && get(faces.data(), faces.size() * sizeof(std::uint32_t));
+        F.resize(nf, 3);
+        const bool uv_faces = header[4] & PUV_UV_FACES;
+        for (std::size_t i = 0; ok && i < faces.size(); i++) ok = faces[i] < nv && (uv_faces || faces[i] < ntc);
+        for (std::uint32_t i = 0; ok && i < nf; i++) {
+            for (int j = 0; j < 3; j++) F(i, j) = faces[3 * i + j];
+        }
+        if (ok && uv_faces) {
+            ok = get(faces.data(), faces.size() * sizeof(std::uint32_t));
+            for (std::size_t i = 0; ok && i < faces.size(); i++) ok = faces[i] < ntc;
+            FTC.resize(nf, 3);
+            for (std::uint32_t i = 0; ok && i < nf; i++) {
+                for (int j = 0; j < 3; j++) FTC(i, j) = faces[3 * i + j];
+            }
+        } else {
+            FTC = F;
+        }
+    }
+    fclose(puv_file);
+    if (!ok) std::cerr << "Error! " << str << " is not a valid .puv file" << std::endl;
+    return ok;
+}
+
+// the .puv next to an OBJ output of the tools, for --binary-bits
+inline bool write_binary_output(const std::string &obj_file, int bits,
+                                const Eigen::Ref<const Eigen::MatrixXd> &V,
+                                const Eigen::Ref<const Eigen::MatrixXi> &F,
+                                const Eigen::Ref<const Eigen::MatrixXd> &TC,
+                                const Eigen::Ref<const Eigen::MatrixXi> &FTC)
+{
+    const std::string puv_file = obj_file.substr(0, obj_file.size() - 4) + ".puv";
+    double error = 0.0;
+    if (!writePUV(puv_file, V, F, TC, FTC, bits, &error)) return false;
+    std::cout << puv_file << ": " << bits << " bit uvs, max uv error " << error << std::endl;
+    return true;
+}
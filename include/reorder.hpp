@@ -0,0 +1,263 @@
+#pragma once
+
+// Locality improving permutations of the vertices and faces of a mesh.
+//   rcm     reverse Cuthill-McKee on the vertex graph: small laplacian bandwidth
+//   morton  Z-order of the vertex positions: spatially close vertices are close in memory
+// Faces follow their smallest (reordered) vertex. The permutation is applied
+// to V, F and TC after loading and undone before writing, so outputs keep the
+// input order.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+
+namespace reorder {
+
+// unique vertex neighbors in compressed rows
+inline void vertex_adjacency(int nv, const Eigen::Ref<const Eigen::MatrixXi> &F, std::vector<int> &offset, std::vector<int> &adj)
+{
+    offset.assign(nv + 1, 0);
+    for (int f = 0; f < F.rows(); f++)
+        for (int i = 0; i < 3; i++) offset[F(f, i) + 1] += 2;
+    for (int v = 0; v < nv; v++) offset[v + 1] += offset[v];
+    adj.resize(offset[nv]);
+    std::vector<int> cursor(offset.begin(), offset.end() - 1);
+    for (int f = 0; f < F.rows(); f++) {
+        for (int i = 0; i < 3; i++) {
+            int v = F(f, i);
+            adj[cursor[v]++] = F(f, (i + 1) % 3);
+            adj[cursor[v]++] = F(f, (i + 2) % 3);
+        }
+    }
+
+    // sort and compact every row
+    std::vector<int> size(nv);
+    #pragma omp parallel for
+    for (int v = 0; v < nv; v++) {
+        auto begin = adj.begin() + offset[v];
+        auto end = adj.begin() + offset[v + 1];
+        std::sort(begin, end);
+        size[v] = std::unique(begin, end) - begin;
+    }
+    int k = 0;
+    for (int v = 0; v < nv; v++) {
+        int start = offset[v];
+        offset[v] = k;
+        for (int i = 0; i < size[v]; i++) adj[k++] = adj[start + i];
+    }
+    offset[nv] = k;
+    adj.resize(k);
+}
+
+// breadth first levels from root, returns the last visited vertex
+inline int bfs_last(int root, const std::vector<int> &offset, const std::vector<int> &adj,
+                    std::vector<int> &mark, int stamp)
+{
+    std::vector<int> queue(1, root);
+    mark[root] = stamp;
+    for (std::size_t head = 0; head < queue.size(); head++) {
+        int v = queue[head];
+        for (int i = offset[v]; i < offset[v + 1]; i++) {
+            if (mark[adj[i]] != stamp) {
+                mark[adj[i]] = stamp;
+                queue.push_back(adj[i]);
+            }
+        }
+    }
+    return queue.back();
+}
+
+// returns order[new] = old
+inline std::vector<int> rcm(int nv, const Eigen::Ref<const Eigen::MatrixXi> &F)
+{
+    std::vector<int> offset, adj;
+    vertex_adjacency(nv, F, offset, adj);
+    auto degree = [&](int v) { return offset[v + 1] - offset[v]; };
+
+    std::vector<int> order;
+    order.reserve(nv);
+    std::vector<char> visited(nv, 0);
+    std::vector<int> mark(nv, -1);
+    std::vector<int> by_degree(nv);
+    std::iota(by_degree.begin(), by_degree.end(), 0);
+    std::stable_sort(by_degree.begin(), by_degree.end(), [&](int a, int b) { return degree(a) < degree(b); });
+
+    int stamp = 0;
+    for (int seed : by_degree) {
+        if (visited[seed]) continue;
+        // pseudo peripheral start: end of two breadth first sweeps
+        int root = bfs_last(bfs_last(seed, offset, adj, mark, stamp), offset, adj, mark, stamp + 1);
+        stamp += 2;
+
+        std::size_t head = order.size();
+        order.push_back(root);
+        visited[root] = 1;
+        std::vector<int> next;
+        for (; head < order.size(); head++) {
+            int v = order[head];
+            next.clear();
+            for (int i = offset[v]; i < offset[v + 1]; i++) {
+                if (!visited[adj[i]]) {
+                    visited[adj[i]] = 1;
+                    next.push_back(adj[i]);
+                }
+            }
+            std::sort(next.begin(), next.end(), [&](int a, int b) { return degree(a) < degree(b); });
+            order.insert(order.end(), next.begin(), next.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+inline std::uint64_t spread_bits(std::uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8)  & 0x100f00f00f00f00full;
+    x = (x | x << 4)  & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2)  & 0x1249249249249249ull;
+    return x;
+}
+
+// returns order[new] = old
+inline std::vector<int> morton(const Eigen::Ref<const Eigen::MatrixXd> &V)
+{
+    const int nv = V.rows();
+    Eigen::RowVectorXd lo = V.colwise().minCoeff();
+    Eigen::RowVectorXd extent = V.colwise().maxCoeff() - lo;
+    double scale = extent.maxCoeff() > 0.0 ? 2097151.0 / extent.maxCoeff() : 0.0;
+
+    std::vector<std::uint64_t> code(nv);
+    #pragma omp parallel for
+    for (int v = 0; v < nv; v++) {
+        std::uint64_t c = 0;
+        for (int d = 0; d < std::min(3, (int)V.cols()); d++)
+            c |= spread_bits((std::uint64_t)((V(v, d) - lo(d)) * scale)) << d;
+        code[v] = c;
+    }
+    std::vector<int> order(nv);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return code[a] < code[b]; });
+    return order;
+}
+
+} // namespace reorder
+
+
+// Vertex and face permutation of a mesh; identity until compute() is called.
+struct Reordering {
+    std::vector<int> vertex_order;  // vertex_order[new] = old
+    std::vector<int> vertex_rank;   // vertex_rank[old] = new
+    std::vector<int> face_order;    // face_order[new] = old
+    std::vector<int> face_rank;     // face_rank[old] = new
+
+    bool active() const { return !vertex_order.empty(); }
+
+    // method is "rcm" or "morton"; returns false for an unknown method
+    bool compute(const std::string &method, const Eigen::Ref<const Eigen::MatrixXd> &V,
+                 const Eigen::Ref<const Eigen::MatrixXi> &F)
+    {
+        TRACE_SCOPE("reorder");
+        if (method == "rcm") vertex_order = reorder::rcm(V.rows(), F);
+        else if (method == "morton") vertex_order = reorder::morton(V);
+        else return false;
+
+        vertex_rank.resize(vertex_order.size());
+        for (int i = 0; i < (int)vertex_order.size(); i++) vertex_rank[vertex_order[i]] = i;
+
+        std::vector<int> key(F.rows());
+        for (int f = 0; f < F.rows(); f++)
+            key[f] = std::min(vertex_rank[F(f, 0)], std::min(vertex_rank[F(f, 1)], vertex_rank[F(f, 2)]));
+        face_order.resize(F.rows());
+        std::iota(face_order.begin(), face_order.end(), 0);
+        std::stable_sort(face_order.begin(), face_order.end(), [&](int a, int b) { return key[a] < key[b]; });
+        face_rank.resize(face_order.size());
+        for (int i = 0; i < (int)face_order.size(); i++) face_rank[face_order[i]] = i;
+        return true;
+    }
+
+    // original order -> reordered
+    void apply(Eigen::MatrixXd &V, Eigen::MatrixXi &F) const
+    {
+        if (!active()) return;
+        V = permute_rows(V, vertex_order);
+        F = reorder_faces(F);
+    }
+
+    // texture coordinates too: FTC rows follow the faces, and TC is permuted
+    // like the vertices when it is per vertex (FTC == F)
+    void apply(Eigen::MatrixXd &V, Eigen::MatrixXi &F, Eigen::MatrixXd &TC, Eigen::MatrixXi &FTC) const
+    {
+        if (!active()) return;
+        if (FTC.rows() == F.rows() && TC.rows() == V.rows() && FTC == F) {
+            TC = permute_rows(TC, vertex_order);
+            apply(V, F);
+            FTC = F;
+        } else {
+            apply(V, F);
+            if (FTC.rows() == F.rows()) FTC = permute_rows(FTC, face_order);
+        }
+    }
+
+    // per vertex data only, e.g. the positions of another frame
+    Eigen::MatrixXd reorder_vertices(const Eigen::Ref<const Eigen::MatrixXd> &M) const
+    {
+        if (!active()) return M;
+        return permute_rows(M, vertex_order);
+    }
+
+    // the faces alone, e.g. into a copy when the input is left untouched
+    Eigen::MatrixXi reorder_faces(const Eigen::Ref<const Eigen::MatrixXi> &F) const
+    {
+        if (!active()) return F;
+        return remap(permute_rows(F, face_order), vertex_rank);
+    }
+
+    // reordered -> original order
+    Eigen::MatrixXd restore_vertices(const Eigen::MatrixXd &M) const
+    {
+        if (!active()) return M;
+        return permute_rows(M, vertex_rank);
+    }
+
+    Eigen::MatrixXi restore_faces(const Eigen::MatrixXi &F) const
+    {
+        if (!active()) return F;
+        return remap(permute_rows(F, face_rank), vertex_order);
+    }
+
+    // single indices, for inputs and outputs that reference the original order
+    int new_vertex(int old) const { return active() ? vertex_rank[old] : old; }
+    int old_vertex(int v) const { return active() ? vertex_order[v] : v; }
+    int new_face(int old) const { return active() ? face_rank[old] : old; }
+    int old_face(int f) const { return active() ? face_order[f] : f; }
+
+private:
+    // out.row(i) = M.row(order[i])
+    template <typename Derived>
+    static typename Derived::PlainObject permute_rows(const Eigen::MatrixBase<Derived> &M, const std::vector<int> &order)
+    {
+        typename Derived::PlainObject out(M.rows(), M.cols());
+        #pragma omp parallel for
+        for (int i = 0; i < (int)M.rows(); i++) out.row(i) = M.row(order[i]);
+        return out;
+    }
+
+    static Eigen::MatrixXi remap(const Eigen::Ref<const Eigen::MatrixXi> &F, const std::vector<int> &map)
+    {
+        Eigen::MatrixXi out(F.rows(), F.cols());
+        #pragma omp parallel for
+        for (int f = 0; f < (int)F.rows(); f++)
+            for (int i = 0; i < F.cols(); i++) out(f, i) = map[F(f, i)];
+        return out;
+    }
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+// On-disk cache of tool outputs, keyed by a hash of the input files, the tool
+// version and its parameters. Enabled by the PARAM_CACHE_DIR environment
+// variable; PARAM_CACHE_MAX_MB bounds its size (default 10240).
+//
+// Entries are published with rename(), so concurrent processes only ever see
+// complete files. Hits are copied out (reflinked where the filesystem can),
+// never linked, so an output modified later cannot alter the cache. Eviction removes the least recently used entries and runs
+// under a non blocking flock, so at most one process evicts at a time.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "trace.hpp"
+
+#ifndef PARAMETRIZATION_VERSION
+#define PARAMETRIZATION_VERSION "dev"
+#endif
+
+
+// streaming 64 bit hash with four independent lanes (xxHash64 style rounds)
+class FastHash {
+public:
+    FastHash() : lanes{P1 + P2, P2, 0, 0ull - P1}, total(0), pending(0) {}
+
+    void update(const void *data, std::size_t size)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        total += size;
+        while (size > 0) {
+            std::size_t take = std::min(size, (std::size_t)32 - pending);
+            std::memcpy(stripe + pending, p, take);
+            pending += take;
+            p += take;
+            size -= take;
+            if (pending == 32) {
+                for (int i = 0; i < 4; i++) lanes[i] = round(lanes[i], read64(stripe + 8 * i));
+                pending = 0;
+            }
+        }
+    }
+
+    void update(const std::string &s)
+    {
+        std::uint64_t size = s.size();
+        update(&size, sizeof(size));
+        update(s.data(), s.size());
+    }
+
+    std::uint64_t digest() const
+    {
+        std::uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        for (int i = 0; i < 4; i++) h = (h ^ round(0, lanes[i])) * P1 + P4;
+        h += total;
+        for (std::size_t i = 0; i < pending; i++) h = rotl(h ^ (stripe[i] * P5), 11) * P1;
+        h ^= h >> 33; h *= P2;
+        h ^= h >> 29; h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr std::uint64_t P1 = 11400714785074694791ull;
+    static constexpr std::uint64_t P2 = 14029467366897019727ull;
+    static constexpr std::uint64_t P3 = 1609587929392839161ull;
+    static constexpr std::uint64_t P4 = 9650029242287828579ull;
+    static constexpr std::uint64_t P5 = 2870177450012600261ull;
+
+    static std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static std::uint64_t round(std::uint64_t acc, std::uint64_t in) { return rotl(acc + in * P2, 31) * P1; }
+    static std::uint64_t read64(const unsigned char *p)
+    {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    std::uint64_t lanes[4];
+    std::uint64_t total;
+    unsigned char stripe[32];
+    std::size_t pending;
+};
+
+
+class ResultCache {
+public:
+    ResultCache(const std::string &tool, const std::string &params)
+    {
+        const char *dir_env = std::getenv("PARAM_CACHE_DIR");
+        if (dir_env == NULL || dir_env[0] == '\0') return;
+        dir = dir_env;
+        long long max_mb = 10240;
+        const char *max_env = std::getenv("PARAM_CACHE_MAX_MB");
+        if (max_env != NULL) {
+            char *end = NULL;
+            long long value = std::strtoll(max_env, &end, 10);
+            if (end == max_env || *end != '\0' || value < 0) {
+                std::cerr << "Warning: invalid PARAM_CACHE_MAX_MB=" << max_env << ", using " << max_mb << std::endl;
+            } else {
+                max_mb = value;
+            }
+        }
+        max_bytes = max_mb * 1024LL * 1024LL;
+        mkdir(dir.c_str(), 0775);
+
+        hash.update(std::string(PARAMETRIZATION_VERSION));
+        hash.update(tool);
+        hash.update(params);
+    }
+
+    bool enabled() const { return !dir.empty() && ok; }
+
+    // mixes the content of an input file into the key
+    void add_file(const std::string &path)
+    {
+        if (!enabled()) return;
+        TRACE_SCOPE("cache_hash");
+        FILE *in = fopen(path.c_str(), "rb");
+        if (in == NULL) {
+            ok = false;
+            return;
+        }
+        std::vector<char> buffer(1 << 20);
+        std::size_t n;
+        while ((n = fread(buffer.data(), 1, buffer.size(), in)) > 0) hash.update(buffer.data(), n);
+        fclose(in);
+        hash.update(std::string("\n"));
+    }
+
+    // on a hit the cached output is copied to out_path
+    bool fetch(const std::string &out_path)
+    {
+        if (!enabled()) return false;
+        TRACE_SCOPE("cache_fetch");
+        std::string entry = entry_path();
+        std::string tmp = out_path + ".cache." + std::to_string(getpid());
+        remove(tmp.c_str());
+        if (!copy_file(entry, tmp)) return false;
+        if (rename(tmp.c_str(), out_path.c_str()) != 0) {
+            remove(tmp.c_str());
+            return false;
+        }
+        utimes(entry.c_str(), NULL); // most recently used
+        std::cout << "Cache hit " << out_path << std::endl;
+        return true;
+    }
+
+    // publishes out_path as the result for this key, then trims the cache
+    void store(const std::string &out_path)
+    {
+        if (!enabled()) return;
+        TRACE_SCOPE("cache_store");
+        std::string tmp = dir + "/.tmp." + std::to_string(getpid()) + "." + key();
+        if (!copy_file(out_path, tmp) || rename(tmp.c_str(), entry_path().c_str()) != 0) {
+            remove(tmp.c_str());
+            return;
+        }
+        evict();
+    }
+
+    std::string key() const
+    {
+        char buffer[17];
+        snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash.digest());
+        return buffer;
+    }
+
+private:
+    std::string entry_path() const { return dir + "/" + key() + ".out"; }
+
+    static bool copy_file(const std::string &from, const std::string &to)
+    {
+        FILE *in = fopen(from.c_str(), "rb");
+        if (in == NULL) return false;
+        FILE *out = fopen(to.c_str(), "wb");
+        if (out == NULL) {
+            fclose(in);
+            return false;
+        }
+#ifdef FICLONE
+        // copy on write filesystems share the blocks, not the inode
+        if (ioctl(fileno(out), FICLONE, fileno(in)) == 0) {
+            fclose(in);
+            if (fclose(out) == 0) return true;
+            remove(to.c_str());
+            return false;
+        }
+#endif
+        std::vector<char> buffer(1 << 20);
+        std::size_t n;
+        bool good = true;
+        while ((n = fread(buffer.data(), 1, buffer.size(), in)) > 0) good = good && fwrite(buffer.data(), 1, n, out) == n;
+        good = !ferror(in) && good;
+        fclose(in);
+        good = (fclose(out) == 0) && good;
+        if (!good) remove(to.c_str());
+        return good;
+    }
+
+    void evict()
+    {
+        std::string lock_path = dir + "/.lock";
+        int fd = open(lock_path.c_str(), O_CREAT | O_RDWR, 0664);
+        if (fd < 0) return;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) { // someone else is evicting
+            close(fd);
+            return;
+        }
+
+        std::vector<std::pair<time_t, std::pair<long long, std::string>>> entries;
+        long long total = 0;
+        if (DIR *d = opendir(dir.c_str())) {
+            while (struct dirent *e = readdir(d)) {
+                std::string name(e->d_name);
+                if (name.size() < 4 || name.compare(name.size() - 4, 4, ".out") != 0) continue;
+                std::string path = dir + "/" + name;
+                struct stat st;
+                if (stat(path.c_str(), &st) != 0) continue;
+                entries.push_back({st.st_mtime, {(long long)st.st_size, path}});
+                total += st.st_size;
+            }
+            closedir(d);
+        }
+
+        std::sort(entries.begin(), entries.end());
+        for (std::size_t i = 0; i < entries.size() && total > max_bytes; i++) {
+            if (remove(entries[i].second.second.c_str()) == 0) total -= entries[i].second.first;
+        }
+
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+
+    std::string dir;
+    long long max_bytes = 0;
+    bool ok = true;
+    FastHash hash;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+// Wall clock budget and termination signals for the solver loops. The loops
+// check the budget between iterations and stop early, so the tool still
+// writes its last (flip-free) iterate and reports the run as partial.
+
+#include <signal.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+
+
+class RunBudget {
+public:
+    // starts the clock and installs the SIGTERM / SIGINT handlers;
+    // seconds <= 0 means no deadline
+    void start(double seconds)
+    {
+        begin = std::chrono::steady_clock::now();
+        budget = seconds;
+        signal_flag() = 0;
+        std::signal(SIGTERM, &RunBudget::on_signal);
+        std::signal(SIGINT, &RunBudget::on_signal);
+    }
+
+    double elapsed() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    // true if a signal arrived, or if another iteration of the given length
+    // would not fit in the budget
+    bool should_stop(double iteration_seconds)
+    {
+        if (signal_flag() != 0) {
+            why = "signal";
+        } else if (budget > 0.0 && elapsed() + iteration_seconds > budget) {
+            why = "deadline";
+        }
+        return stopped();
+    }
+
+    bool stopped() const { return !why.empty(); }
+    const std::string &reason() const { return why; }
+
+private:
+    static volatile std::sig_atomic_t &signal_flag()
+    {
+        static volatile std::sig_atomic_t flag = 0;
+        return flag;
+    }
+
+    // a second signal terminates as usual
+    static void on_signal(int sig)
+    {
+        signal_flag() = sig;
+        std::signal(sig, SIG_DFL);
+    }
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    double budget = 0.0;
+    std::string why;
+};
+
+inline RunBudget &run_budget()
+{
+    static RunBudget budget;
+    return budget;
+}
+
+
+// Per-run summary written next to the output, <output>.report.json
+struct RunReport {
+    std::string tool;
+    std::string output;
+    int iterations = 0;             // performed by this run
+    int requested_iterations = 0;
+    double energy = 0.0;
+    int flips = 0;
+    long long overlaps = -1;        // overlapping uv face pairs, -1 if not checked
+    int frames = -1;                // sequence frames solved, -1 without a sequence
+    int requested_frames = 0;
+
+    bool write(const std::string &path) const
+    {
+        const RunBudget &budget = run_budget();
+        std::string tmp = path + ".tmp";
+        FILE *out = fopen(tmp.c_str(), "w");
+        if (out == NULL) return false;
+        fprintf(out, "{\n");
+        fprintf(out, "  \"tool\": \"%s\",\n", tool.c_str());
+        fprintf(out, "  \"output\": \"%s\",\n", output.c_str());
+        fprintf(out, "  \"status\": \"%s\",\n", budget.stopped() ? "partial" : "complete");
+        fprintf(out, "  \"stop_reason\": \"%s\",\n", budget.reason().c_str());
+        fprintf(out, "  \"iterations\": %d,\n", iterations);
+        fprintf(out, "  \"requested_iterations\": %d,\n", requested_iterations);
+        fprintf(out, "  \"energy\": %0.17g,\n", energy);
+        fprintf(out, "  \"flips\": %d,\n", flips);
+        if (overlaps >= 0) fprintf(out, "  \"overlaps\": %lld,\n", overlaps);
+        if (frames >= 0) {
+            fprintf(out, "  \"frames\": %d,\n", frames);
+            fprintf(out, "  \"requested_frames\": %d,\n", requested_frames);
+        }
+        fprintf(out, "  \"seconds\": %0.3f\n", budget.elapsed());
+        fprintf(out, "}\n");
+        if (fclose(out) != 0) {
+            remove(tmp.c_str());
+            return false;
+        }
+        return rename(tmp.c_str(), path.c_str()) == 0;
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+// Sequence mode for animation caches: every frame has the connectivity of
+// the first one and only the vertex positions change. The frame files are
+// listed one per line in a text file (blank lines and lines starting with #
+// are skipped). The next frame is loaded on a background thread while the
+// current one is solved.
+
+#include <Eigen/Core>
+
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+
+inline bool read_frame_list(const std::string &path, std::vector<std::string> &frames)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    frames.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        frames.push_back(line);
+    }
+    return true;
+}
+
+// Frames in list order, each checked against the reference connectivity F
+// (in input order). The loader reads the positions and faces of one file.
+class FrameReader {
+public:
+    typedef std::function<bool(const std::string &, Eigen::MatrixXd &, Eigen::MatrixXi &)> Loader;
+
+    FrameReader(const std::vector<std::string> &frames, const Eigen::MatrixXi &F, Loader load)
+        : frames(frames), F(F), load(load)
+    {
+        prefetch();
+    }
+
+    ~FrameReader()
+    {
+        if (pending.valid()) pending.wait();
+    }
+
+    // false once every frame was returned; V is empty if the frame could not
+    // be read or has another connectivity (the reason is printed)
+    bool next(std::string &file, Eigen::MatrixXd &V)
+    {
+        if (current >= (int)frames.size()) return false;
+        {
+            TRACE_SCOPE("wait_frame");
+            V = pending.get();
+        }
+        file = frames[current++];
+        prefetch();
+        return true;
+    }
+
+private:
+    void prefetch()
+    {
+        if (current >= (int)frames.size()) return;
+        const std::string file = frames[current];
+        pending = std::async(std::launch::async, [this, file]() {
+            Eigen::MatrixXd V;
+            Eigen::MatrixXi F_frame;
+            if (!load(file, V, F_frame)) {
+                std::cerr << "Error! Cannot read frame " << file << std::endl;
+                return Eigen::MatrixXd();
+            }
+            if (V.rows() == 0 || F_frame.rows() != F.rows() || F_frame.cols() != F.cols() || F_frame != F) {
+                std::cerr << "Error! Frame " << file << " does not have the connectivity of the first frame" << std::endl;
+                return Eigen::MatrixXd();
+            }
+            return V;
+        });
+    }
+
+    std::vector<std::string> frames;
+    Eigen::MatrixXi F;
+    Loader load;
+    int current = 0;
+    std::future<Eigen::MatrixXd> pending;
+};
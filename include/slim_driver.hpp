@@ -0,0 +1,267 @@
+#pragma once
+
+// Iteration loop shared by the SLIM tools: runs igl::slim_solve, the
+// in-tree SlimEngine or the NewtonEngine one iteration at a time so the state
+// can be checkpointed between iterations.
+
+#include <igl/slim.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "checkpoint.hpp"
+#include "newton_engine.hpp"
+#include "reorder.hpp"
+#include "run_budget.hpp"
+#include "slim_engine.hpp"
+#include "trace.hpp"
+
+
+inline SlimCheckpoint snapshot_slim(const igl::SLIMData &data, int iteration, int total_iterations)
+{
+    SlimCheckpoint ckpt;
+    ckpt.V_o = data.V_o;
+    ckpt.energy = data.energy;
+    ckpt.iteration = iteration;
+    ckpt.total_iterations = total_iterations;
+    ckpt.slim_energy = (int)data.slim_energy;
+    ckpt.soft_const_p = data.soft_const_p;
+    ckpt.exp_factor = data.exp_factor;
+    ckpt.num_vertices = data.V.rows();
+    ckpt.num_faces = data.F.rows();
+    return ckpt;
+}
+
+template <typename Scalar>
+inline SlimCheckpoint snapshot_slim(const SlimEngine<Scalar> &engine, int iteration, int total_iterations)
+{
+    SlimCheckpoint ckpt;
+    ckpt.V_o = engine.uv();
+    ckpt.energy = engine.energy;
+    ckpt.iteration = iteration;
+    ckpt.total_iterations = total_iterations;
+    ckpt.slim_energy = (int)igl::MappingEnergyType::SYMMETRIC_DIRICHLET;
+    ckpt.soft_const_p = engine.soft_const_p;
+    ckpt.exp_factor = 1.0;
+    ckpt.num_vertices = engine.num_vertices();
+    ckpt.num_faces = engine.num_faces();
+    return ckpt;
+}
+
+// where and how often run_slim checkpoints. The uv of a checkpoint is stored
+// in the input vertex order, so a run can be resumed with another --reorder.
+struct CheckpointTarget {
+    std::string path;               // empty: no checkpoints
+    int every = 0;                  // iterations between checkpoints, 0 disables them
+    const Reordering *reordering = nullptr;     // order the solver works in
+
+    CheckpointTarget() {}
+    CheckpointTarget(const std::string &path, int every, const Reordering &reordering)
+        : path(path), every(every), reordering(&reordering) {}
+};
+
+inline bool slim_step(igl::SLIMData &data)
+{
+    igl::slim_solve(data, 1);
+    return true;
+}
+
+template <typename Scalar>
+inline bool slim_step(SlimEngine<Scalar> &engine)
+{
+    return engine.iterate();
+}
+
+inline bool slim_step(NewtonEngine &engine)
+{
+    return engine.iterate();
+}
+
+// reads the checkpoint at path and checks it belongs to this mesh and
+// settings; its uv is returned in the order of the solver (see
+// CheckpointTarget)
+inline bool load_slim_checkpoint(const std::string &path,
+                                 const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                                 igl::MappingEnergyType slim_energy, double soft_const_p,
+                                 const Reordering &reordering, SlimCheckpoint &ckpt)
+{
+    if (!read_checkpoint(path, ckpt)) {
+        std::cerr << "Warning: no checkpoint found at " << path << ", starting from scratch" << std::endl;
+        return false;
+    }
+    if (ckpt.num_vertices != V.rows() || ckpt.num_faces != F.rows() || ckpt.V_o.rows() != V.rows()) {
+        std::cerr << "Warning: checkpoint " << path << " belongs to another mesh, ignoring it" << std::endl;
+        return false;
+    }
+    if (ckpt.slim_energy != (int)slim_energy || ckpt.soft_const_p != soft_const_p) {
+        std::cerr << "Warning: checkpoint " << path << " was written with other solver settings, ignoring it" << std::endl;
+        return false;
+    }
+    ckpt.V_o = reordering.reorder_vertices(ckpt.V_o);
+    return true;
+}
+
+// runs iterations [first_iteration, total_iterations) and submits a
+// checkpoint every checkpoint.every iterations.
+// Returns the iteration reached, which is total_iterations unless the solver
+// asked to stop (see SlimEngine::iterate) or the run budget ran out (see
+// run_budget.hpp); in the latter case a final checkpoint is submitted so the
+// run can be resumed.
+template <typename Solver>
+inline int run_slim(Solver &solver, int first_iteration, int total_iterations,
+                    const CheckpointTarget &checkpoint = CheckpointTarget())
+{
+    std::unique_ptr<AsyncCheckpointWriter> writer;
+    if (checkpoint.every > 0 && !checkpoint.path.empty()) {
+        writer.reset(new AsyncCheckpointWriter(checkpoint.path));
+    }
+    auto submit = [&](int iteration) {
+        SlimCheckpoint ckpt = snapshot_slim(solver, iteration, total_iterations);
+        if (checkpoint.reordering) ckpt.V_o = checkpoint.reordering->restore_vertices(ckpt.V_o);
+        writer->submit(ckpt);
+    };
+
+    RunBudget &budget = run_budget();
+    double slowest = 0.0;
+    int it = first_iteration;
+    for (; it < total_iterations; it++) {
+        if (budget.should_stop(slowest)) break;
+        auto start = std::chrono::steady_clock::now();
+        if (!slim_step(solver)) break;
+        slowest = std::max(slowest, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        if (writer && (it + 1) % checkpoint.every == 0 && it + 1 < total_iterations) {
+            TRACE_SCOPE("checkpoint");
+            submit(it + 1);
+        }
+    }
+    if (budget.stopped()) {
+        std::cerr << "Warning: stopped at iteration " << it << " (" << budget.reason() << ")" << std::endl;
+        if (writer) submit(it);
+    }
+    trace::counter("iterations", it - first_iteration);
+    return it;
+}
+
+// SLIM with float32 storage of the per-face and per-vertex state. If rounding
+// to float ever flips a face, the remaining iterations run in double storage
+// from the last flip-free iterate. The engines compute area and grad from V
+// themselves, so no double copy stays next to the float one. Returns the
+// iteration reached.
+inline int run_slim_single_precision(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                                      const Eigen::MatrixXd &uv_init,
+                                      const Eigen::VectorXi &b, const Eigen::MatrixXd &bc, double soft_const_p,
+                                      int first_iteration, int total_iterations, const CheckpointTarget &checkpoint,
+                                      Eigen::MatrixXd &uv, double &energy)
+{
+    Eigen::MatrixXd last_uv;
+    int reached;
+    {
+        SlimEngine<float> engine;
+        {
+            TRACE_SCOPE("precompute");
+            engine.precompute(V, F, uv_init, b, bc, soft_const_p);
+        }
+        std::cout << "energy = " << engine.energy << std::endl;
+        reached = run_slim(engine, first_iteration, total_iterations, checkpoint);
+        last_uv = engine.uv();
+        energy = engine.energy;
+    }
+
+    if (reached < total_iterations && !run_budget().stopped()) {
+        TRACE_SCOPE("double_fallback");
+        std::cerr << "Warning: single precision flipped a face at iteration " << reached
+                  << ", continuing in double precision" << std::endl;
+        SlimEngine<double> engine;
+        engine.precompute(V, F, last_uv, b, bc, soft_const_p);
+        reached = run_slim(engine, reached, total_iterations, checkpoint);
+        last_uv = engine.uv();
+        energy = engine.energy;
+    }
+    uv.swap(last_uv);
+    return reached;
+}
+
+// SLIM on the in-tree engine in double precision. Penalties of at least
+// SlimEngine::hard_constraint_p eliminate the pinned vertices from the global
+// system instead of adding the penalty to it. Returns the iteration reached.
+inline int run_slim_engine(const MeshOperators &ops, const Eigen::Ref<const Eigen::MatrixXi> &F, const Eigen::MatrixXd &uv_init,
+                           const Eigen::VectorXi &b, const Eigen::MatrixXd &bc, double soft_const_p,
+                           int first_iteration, int total_iterations, const CheckpointTarget &checkpoint,
+                           Eigen::MatrixXd &uv, double &energy)
+{
+    SlimEngine<double> engine;
+    {
+        TRACE_SCOPE("precompute");
+        engine.precompute(ops, F, uv_init, b, bc, soft_const_p);
+    }
+    std::cout << "energy = " << engine.energy << std::endl;
+    int reached = run_slim(engine, first_iteration, total_iterations, checkpoint);
+    uv = engine.uv();
+    energy = engine.energy;
+    return reached;
+}
+
+// projected Newton iterations, stops early once converged; returns the
+// iteration reached
+inline int run_newton(const MeshOperators &ops, const Eigen::Ref<const Eigen::MatrixXi> &F, const Eigen::MatrixXd &uv_init,
+                       const Eigen::VectorXi &b, const Eigen::MatrixXd &bc, double soft_const_p,
+                       int first_iteration, int total_iterations, const CheckpointTarget &checkpoint,
+                       Eigen::MatrixXd &uv, double &energy)
+{
+    NewtonEngine engine;
+    {
+        TRACE_SCOPE("precompute");
+        engine.precompute(ops, F, uv_init, b, bc, soft_const_p);
+    }
+    std::cout << "energy = " << engine.energy << std::endl;
+    int reached = run_slim(engine, first_iteration, total_iterations, checkpoint);
+    std::cout << "newton stopped after " << reached - first_iteration << " iterations" << std::endl;
+    uv = engine.uv();
+    energy = engine.energy;
+    return reached;
+}
+
+// Sequence mode: the engine was set up on the first frame and holds its
+// result; every following frame only updates the geometry and runs up to
+// `iterations` iterations from the previous uv. next(V) returns the input
+// order positions of the next frame, false after the last one or if it could
+// not be read. Results are written behind on a background thread:
+// write(frame, V, uv) receives input order arrays and returns false if the
+// output could not be written, which stops the sequence. Returns the number
+// of frames solved and written.
+template <typename Engine>
+inline int solve_sequence(Engine &engine, std::function<bool(Eigen::MatrixXd &)> next,
+                          const Reordering &reordering, int iterations,
+                          std::function<bool(int, const Eigen::MatrixXd &, const Eigen::MatrixXd &)> write)
+{
+    TRACE_SCOPE("sequence");
+    std::future<bool> writing;
+    Eigen::MatrixXd V;
+    int solved = 0;
+    while (!run_budget().stopped() && next(V)) {
+        TRACE_SCOPE("frame");
+        V = reordering.reorder_vertices(V);
+        engine.update_geometry(V);
+        run_slim(engine, 0, iterations);
+        std::cout << "frame " << solved << ": energy = " << engine.energy << std::endl;
+
+        if (writing.valid() && !writing.get()) {
+            solved--;
+            break;
+        }
+        Eigen::MatrixXd V_out = reordering.restore_vertices(V);
+        Eigen::MatrixXd uv_out = reordering.restore_vertices(engine.uv());
+        const int frame = solved;
+        writing = std::async(std::launch::async, [write, frame, V_out, uv_out]() { return write(frame, V_out, uv_out); });
+        solved++;
+    }
+    if (writing.valid() && !writing.get()) solved--;
+    trace::counter("frames", solved);
+    return solved;
+}
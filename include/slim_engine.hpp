@@ -0,0 +1,485 @@
+#pragma once
+
+// In-tree SLIM solver for the symmetric Dirichlet energy of a 2D
+// parametrization (Rabinovich et al. 2017, same scheme as igl::slim).
+//
+// Per-face and per-vertex state (hat function gradients, areas, proxy
+// weights and the uv iterate) is stored with the Scalar template parameter,
+// so SlimEngine<float> halves the memory traffic of the local steps. The
+// global linear solve and every energy reduction are carried out in double.
+// The global matrix is assembled in parallel into a fixed pattern, see
+// csr_assembly.hpp.
+//
+// Penalties of at least hard_constraint_p (such as the 1e35 the SLIM tools
+// use to pin the boundary) are treated as hard constraints: the pinned
+// vertices are placed on their targets and their unknowns are eliminated,
+// moving their coupling to the right hand side. The reduced system stays well
+// conditioned instead of mixing 1e35 with entries of order one.
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "amg.hpp"
+#include "csr_assembly.hpp"
+#include "jacobian2d.hpp"
+#include "mesh_operators.hpp"
+
+
+template <typename Scalar>
+class SlimEngine {
+public:
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorS;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> PerFace;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 2> UV;
+    typedef Eigen::SparseMatrix<double> SpMat;
+
+    double energy = 0.0;            // normalized by the mesh area, like SLIMData::energy
+    double soft_const_p = 0.0;
+    double proximal_p = 1e-4;       // same regularization as igl::slim
+    double mesh_area = 0.0;
+    // constrained vertices are eliminated (their uv stays at bc) when the
+    // penalty is at least this large; smaller penalties stay soft
+    double hard_constraint_p = 1e10;
+    // solve the global step with AMG preconditioned conjugate gradient
+    // instead of a sparse Cholesky factorization: no fill-in, memory linear
+    // in the mesh size
+    bool iterative = false;
+
+    SlimEngine() {}
+    // F, area and grad view buffers the engine does not own, see precompute
+    SlimEngine(const SlimEngine &) = delete;
+    SlimEngine &operator=(const SlimEngine &) = delete;
+
+    // b are pinned to bc with a soft penalty, as in igl::slim_precompute.
+    // The inputs may be Eigen::Map views of caller buffers, they are not
+    // copied; F is kept by reference and must outlive the engine.
+    void precompute(const Eigen::Ref<const Eigen::MatrixXd> &V, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                    const Eigen::Ref<const Eigen::MatrixXd> &uv_init,
+                    const Eigen::VectorXi &b, const Eigen::Ref<const Eigen::MatrixXd> &bc, double soft_p)
+    {
+        Eigen::VectorXd area_d;
+        FaceGradients grad_d;
+        local_gradients(V, F, area_d, grad_d);
+        own_operators(area_d, grad_d);
+        setup(F, V.rows(), uv_init, b, bc, soft_p);
+    }
+
+    // same, reusing operators already assembled for the initialization. In
+    // double precision area and grad are borrowed, not copied: ops must
+    // outlive the engine and keep them.
+    void precompute(const MeshOperators &ops, const Eigen::Ref<const Eigen::MatrixXi> &F,
+                    const Eigen::Ref<const Eigen::MatrixXd> &uv_init,
+                    const Eigen::VectorXi &b, const Eigen::Ref<const Eigen::MatrixXd> &bc, double soft_p)
+    {
+        borrow_operators(ops, std::is_same<Scalar, double>());
+        setup(F, ops.num_vertices, uv_init, b, bc, soft_p);
+    }
+
+    // new vertex positions with the same connectivity: the uv iterate (warm
+    // start), the constraints and the symbolic factorization are kept
+    void update_geometry(const Eigen::Ref<const Eigen::MatrixXd> &V)
+    {
+        Eigen::VectorXd area_d;
+        FaceGradients grad_d;
+        local_gradients(V, F, area_d, grad_d);
+        own_operators(area_d, grad_d);
+        energy = compute_energy(iterate_as_double()) / mesh_area;
+    }
+
+    // Runs up to `iterations` iterations. Returns the number performed; fewer
+    // means rounding the iterate to Scalar flipped a face, in which case the
+    // last flip-free iterate is kept and the caller should continue in double.
+    int solve(int iterations)
+    {
+        for (int it = 0; it < iterations; it++) {
+            if (!iterate()) return it;
+        }
+        return iterations;
+    }
+
+    // one local/global iteration with a flip-avoiding line search
+    bool iterate()
+    {
+        local_step();
+        Eigen::VectorXd target = global_step();
+        Eigen::VectorXd current = iterate_as_double();
+        return line_search(current, target);
+    }
+
+    // moves towards target as far as the flip-free line search allows;
+    // returns true if the energy decreased
+    bool step_towards(const Eigen::MatrixXd &target)
+    {
+        Eigen::VectorXd t(2 * n);
+        t.head(n) = target.col(0);
+        t.tail(n) = target.col(1);
+        double before = energy;
+        line_search(iterate_as_double(), t);
+        return energy < before;
+    }
+
+    Eigen::MatrixXd uv() const { return uv_.template cast<double>(); }
+    int num_vertices() const { return n; }
+    int num_faces() const { return F.rows(); }
+    const FaceView &faces() const { return F; }
+    bool hard_constraints() const { return soft_const_p >= hard_constraint_p; }
+
+    // number of faces with non positive jacobian determinant
+    int flips() const
+    {
+        Eigen::VectorXd x = iterate_as_double();
+        int count = 0;
+        #pragma omp parallel for reduction(+:count)
+        for (int f = 0; f < (int)F.rows(); f++) {
+            count += jacobian(f, x.data(), x.data() + n).determinant() <= 0.0;
+        }
+        return count;
+    }
+
+protected:
+    // area and grad are in place
+    void setup(const Eigen::Ref<const Eigen::MatrixXi> &F, int num_vertices, const Eigen::Ref<const Eigen::MatrixXd> &uv_init,
+               const Eigen::VectorXi &b, const Eigen::Ref<const Eigen::MatrixXd> &bc, double soft_p)
+    {
+        view_faces(this->F, F);
+        n = num_vertices;
+        this->b = b;
+        // targets representable in Scalar, so pinned vertices can sit exactly on them
+        this->bc = bc.leftCols(2).cast<Scalar>().template cast<double>();
+        soft_const_p = soft_p;
+        uv_ = uv_init.leftCols(2).cast<Scalar>();
+
+        // unknowns of the global system: [u; v] without the eliminated dofs
+        free_index.resize(2 * n);
+        place_constraints();
+        if (hard_constraints()) {
+            std::fill(free_index.begin(), free_index.end(), 0);
+            for (int i = 0; i < b.size(); i++) {
+                for (int k = 0; k < 2; k++) free_index[k * n + b(i)] = -1;
+            }
+            num_free = 0;
+            for (int d = 0; d < 2 * n; d++) {
+                if (free_index[d] == 0) free_index[d] = num_free++;
+            }
+        } else {
+            std::iota(free_index.begin(), free_index.end(), 0);
+            num_free = 2 * n;
+        }
+
+        weights.resize(F.rows(), 7);
+        assembly = CsrAssembly();
+        analyzed = false;
+        energy = compute_energy(iterate_as_double()) / mesh_area;
+    }
+
+    // area and grad computed for this engine: moved in double precision, cast
+    // otherwise; the double arrays are released either way
+    void own_operators(Eigen::VectorXd &area_d, FaceGradients &grad_d)
+    {
+        mesh_area = area_d.sum();
+        take(area_storage, area_d);
+        take(grad_storage, grad_d);
+        view_operators(area_storage.data(), grad_storage.data(), area_storage.size());
+    }
+
+    void borrow_operators(const MeshOperators &ops, std::true_type)
+    {
+        mesh_area = ops.area.sum();
+        area_storage.resize(0);
+        grad_storage.resize(0, 0);
+        view_operators(ops.area.data(), ops.grad.data(), ops.area.size());
+    }
+
+    void borrow_operators(const MeshOperators &ops, std::false_type)
+    {
+        mesh_area = ops.area.sum();
+        area_storage = ops.area.cast<Scalar>();
+        grad_storage = ops.grad.cast<Scalar>();
+        view_operators(area_storage.data(), grad_storage.data(), area_storage.size());
+    }
+
+    void view_operators(const Scalar *area_data, const Scalar *grad_data, Eigen::Index faces)
+    {
+        new (&area) Eigen::Map<const VectorS>(area_data, faces);
+        new (&grad) Eigen::Map<const PerFace>(grad_data, faces, 6);
+    }
+
+    template <typename To, typename From>
+    static void take(To &to, From &from)
+    {
+        to = from.template cast<typename To::Scalar>();
+        from = From();
+    }
+
+    template <typename Same>
+    static void take(Same &to, Same &from)
+    {
+        to.swap(from);
+        from = Same();
+    }
+
+    // hard constraints: the pinned vertices sit on their targets
+    void place_constraints()
+    {
+        if (!hard_constraints()) return;
+        for (int i = 0; i < b.size(); i++) {
+            for (int k = 0; k < 2; k++) uv_(b(i), k) = (Scalar)bc(i, k);
+        }
+    }
+
+    Eigen::VectorXd iterate_as_double() const
+    {
+        Eigen::VectorXd x(2 * n);
+        x.head(n) = uv_.col(0).template cast<double>();
+        x.tail(n) = uv_.col(1).template cast<double>();
+        return x;
+    }
+
+    // J = [du/dx du/dy; dv/dx dv/dy] in the local frame of face f
+    Eigen::Matrix2d jacobian(int f, const double *u, const double *v) const
+    {
+        Eigen::Matrix2d J = Eigen::Matrix2d::Zero();
+        for (int i = 0; i < 3; i++) {
+            int vi = F(f, i);
+            double gx = grad(f, i), gy = grad(f, 3 + i);
+            J(0, 0) += u[vi] * gx;
+            J(0, 1) += u[vi] * gy;
+            J(1, 0) += v[vi] * gx;
+            J(1, 1) += v[vi] * gy;
+        }
+        return J;
+    }
+
+    // area weighted symmetric dirichlet plus soft constraints, +inf if a face is flipped
+    double compute_energy(const Eigen::VectorXd &x) const
+    {
+        const double *u = x.data(), *v = x.data() + n;
+        double e = 0.0;
+        #pragma omp parallel for reduction(+:e)
+        for (int f = 0; f < (int)F.rows(); f++) {
+            Eigen::Matrix2d J = jacobian(f, u, v);
+            double det = J.determinant();
+            double norm2 = J.squaredNorm();
+            e += det > 0.0 ? (double)area(f) * (norm2 + norm2 / (det * det))
+                           : std::numeric_limits<double>::infinity();
+        }
+        if (hard_constraints()) return e;
+        for (int i = 0; i < b.size(); i++) {
+            double du = u[b(i)] - bc(i, 0), dv = v[b(i)] - bc(i, 1);
+            e += soft_const_p * (du * du + dv * dv);
+        }
+        return e;
+    }
+
+    // proxy weights W and closest rotations R; stores M = W^T W and M R per face
+    void local_step()
+    {
+        Eigen::VectorXd x = iterate_as_double();
+        const double *u = x.data(), *v = x.data() + n;
+
+        #pragma omp parallel for
+        for (int f = 0; f < (int)F.rows(); f++) {
+            Eigen::Matrix2d J = jacobian(f, u, v);
+            Svd2 svd = svd2x2(J(0, 0), J(0, 1), J(1, 0), J(1, 1));
+
+            // symmetric dirichlet: w^2 = (s - s^-3) / (s - 1) = (1 + s)(1 + s^2) / s^3
+            double s1 = svd.s1, s2 = std::max(svd.s2, 1e-8);
+            double w1sq = (1.0 + s1) * (1.0 + s1 * s1) / (s1 * s1 * s1);
+            double w2sq = (1.0 + s2) * (1.0 + s2 * s2) / (s2 * s2 * s2);
+
+            double c = std::cos(svd.phi), s = std::sin(svd.phi);
+            double m00 = c * c * w1sq + s * s * w2sq;
+            double m01 = c * s * (w1sq - w2sq);
+            double m11 = s * s * w1sq + c * c * w2sq;
+
+            double rc = std::cos(svd.phi + svd.theta), rs = std::sin(svd.phi + svd.theta);
+            weights(f, 0) = m00;
+            weights(f, 1) = m01;
+            weights(f, 2) = m11;
+            weights(f, 3) = m00 * rc + m01 * rs;     // (M R)_00
+            weights(f, 4) = -m00 * rs + m01 * rc;    // (M R)_01
+            weights(f, 5) = m01 * rc + m11 * rs;     // (M R)_10
+            weights(f, 6) = -m01 * rs + m11 * rc;    // (M R)_11
+        }
+    }
+
+    // minimizes sum_f A_f |W_f (J_f - R_f)|^2 + proximal + soft constraints;
+    // unknowns are ordered [u; v], eliminated dofs are left out
+    Eigen::VectorXd global_step()
+    {
+        // unknowns: u and v of every vertex that is not eliminated
+        if (assembly.empty()) {
+            assembly.build(F, 2, n, num_free, [this](int b, int v) { return free_index[b * n + v]; });
+        }
+        Eigen::VectorXd x = iterate_as_double();
+        Eigen::VectorXd rhs = Eigen::VectorXd::Zero(num_free);
+        assembly.set_zero();
+        double *values = assembly.values();
+
+        assembly.for_each_face([&](int f) {
+            double A = area(f);
+            double M[2][2] = { { (double)weights(f, 0), (double)weights(f, 1) },
+                               { (double)weights(f, 1), (double)weights(f, 2) } };
+            double MR[2][2] = { { (double)weights(f, 3), (double)weights(f, 4) },
+                                { (double)weights(f, 5), (double)weights(f, 6) } };
+            for (int i = 0; i < 3; i++) {
+                double gxi = grad(f, i), gyi = grad(f, 3 + i);
+                for (int k = 0; k < 2; k++) {
+                    int row = free_index[k * n + F(f, i)];
+                    if (row < 0) continue;
+                    rhs(row) += A * (gxi * MR[k][0] + gyi * MR[k][1]);
+                    for (int j = 0; j < 3; j++) {
+                        double G = gxi * grad(f, j) + gyi * grad(f, 3 + j);
+                        for (int l = 0; l < 2; l++) {
+                            double value = A * M[k][l] * G;
+                            int slot = assembly.slot(F, f, k * 3 + i, l * 3 + j);
+                            // a known column goes to the right hand side
+                            if (slot >= 0) values[slot] += value;
+                            else rhs(row) -= value * x(l * n + F(f, j));
+                        }
+                    }
+                }
+            }
+        });
+
+        for (int d = 0; d < 2 * n; d++) {
+            if (free_index[d] < 0) continue;
+            values[assembly.diagonal(free_index[d])] += proximal_p;
+            rhs(free_index[d]) += proximal_p * x(d);
+        }
+        if (!hard_constraints()) {
+            for (int i = 0; i < b.size(); i++) {
+                for (int k = 0; k < 2; k++) {
+                    values[assembly.diagonal(k * n + b(i))] += soft_const_p;
+                    rhs(k * n + b(i)) += soft_const_p * bc(i, k);
+                }
+            }
+        }
+
+        const SpMat &K = assembly.matrix();
+        Eigen::VectorXd y;
+        if (iterative) {
+            // warm started from the current iterate
+            Eigen::VectorXd guess(num_free);
+            for (int d = 0; d < 2 * n; d++) {
+                if (free_index[d] >= 0) guess(free_index[d]) = x(d);
+            }
+            // the aggregation is kept and only the values of the hierarchy are
+            // recomputed, until a solve on the kept aggregation no longer gets
+            // clearly cheaper than the one before it: the weights have moved
+            // too far from the ones it was built for
+            if (!cg) {
+                cg.reset(new Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, AMGPreconditioner>());
+                cg->setTolerance(1e-8);
+                cg->setMaxIterations(500);
+                cg->analyzePattern(K);
+            } else if (cg_reused && 4 * cg_iterations[1] > 3 * cg_iterations[0]) {
+                cg->analyzePattern(K);
+                cg_reused = false;
+            } else {
+                cg_reused = true;
+            }
+            cg->factorize(K);
+            y = cg->solveWithGuess(rhs, guess);
+            cg_iterations[0] = cg_iterations[1];
+            cg_iterations[1] = cg->iterations();
+        } else {
+            // the sparsity pattern never changes: the symbolic factorization is reused
+            if (!analyzed) {
+                solver.analyzePattern(K);
+                analyzed = true;
+            }
+            solver.factorize(K);
+            y = solver.solve(rhs);
+        }
+
+        // eliminated dofs keep their value
+        Eigen::VectorXd target = x;
+        for (int d = 0; d < 2 * n; d++) {
+            if (free_index[d] >= 0) target(d) = y(free_index[d]);
+        }
+        return target;
+    }
+
+    // largest step along d from x that keeps every face positively oriented
+    double max_flip_free_step(const Eigen::VectorXd &x, const Eigen::VectorXd &d) const
+    {
+        const double *u = x.data(), *v = x.data() + n;
+        const double *du = d.data(), *dv = d.data() + n;
+        double t_max = std::numeric_limits<double>::infinity();
+        #pragma omp parallel for reduction(min:t_max)
+        for (int f = 0; f < (int)F.rows(); f++) {
+            Eigen::Matrix2d J0 = jacobian(f, u, v);
+            Eigen::Matrix2d Jd = jacobian(f, du, dv);
+            double a = Jd.determinant();
+            double bb = J0(0, 0) * Jd(1, 1) + Jd(0, 0) * J0(1, 1) - J0(0, 1) * Jd(1, 0) - Jd(0, 1) * J0(1, 0);
+            double c = J0.determinant();
+            t_max = std::min(t_max, smallest_positive_root(a, bb, c));
+        }
+        return t_max;
+    }
+
+    // flip avoiding backtracking line search, as igl::flip_avoiding_line_search
+    bool line_search(const Eigen::VectorXd &current, const Eigen::VectorXd &target)
+    {
+        Eigen::VectorXd d = target - current;
+        double t = std::min(1.0, 0.8 * max_flip_free_step(current, d));
+        double old_energy = energy * mesh_area;
+
+        Eigen::VectorXd x = current;
+        double new_energy = old_energy;
+        for (int tries = 0; tries < 12; tries++) {
+            x = current + t * d;
+            new_energy = compute_energy(x);
+            if (new_energy < old_energy) break;
+            t /= 2.0;
+        }
+        if (!(new_energy < old_energy)) return true; // no progress, keep the iterate
+
+        UV previous = uv_;
+        uv_.col(0) = x.head(n).cast<Scalar>();
+        uv_.col(1) = x.tail(n).cast<Scalar>();
+
+        // injectivity guard: the energy of the stored (rounded) iterate is
+        // +inf if rounding flipped a face
+        double stored_energy = compute_energy(iterate_as_double());
+        if (!std::isfinite(stored_energy)) {
+            uv_ = previous;
+            return false;
+        }
+        energy = stored_energy / mesh_area;
+        return true;
+    }
+
+    FaceView F = FaceView(nullptr, 0, 3, Eigen::OuterStride<>(0));
+    int n = 0;
+    // F and F x 6, see local_gradients: views of the MeshOperators given to
+    // precompute in double precision, of area_storage and grad_storage else
+    Eigen::Map<const VectorS> area = Eigen::Map<const VectorS>(nullptr, 0);
+    Eigen::Map<const PerFace> grad = Eigen::Map<const PerFace>(nullptr, 0, 6);
+    VectorS area_storage;
+    PerFace grad_storage;
+    PerFace weights;    // F x 7, M = W^T W (3 entries) and M R (4 entries)
+    UV uv_;
+    Eigen::VectorXi b;
+    Eigen::MatrixXd bc;
+    std::vector<int> free_index;    // 2n, row of each dof in the global system, -1 if eliminated
+    int num_free = 0;
+
+    CsrAssembly assembly;           // pattern of the global system
+    Eigen::SimplicialLDLT<SpMat> solver;
+    bool analyzed = false;
+    std::unique_ptr<Eigen::ConjugateGradient<SpMat, Eigen::Lower | Eigen::Upper, AMGPreconditioner>> cg;
+    bool cg_reused = false;             // the last solve used a kept aggregation
+    Eigen::Index cg_iterations[2] = {0, 0};     // CG iterations of the last two solves
+};
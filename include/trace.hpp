@@ -0,0 +1,315 @@
+#pragma once
+
+// Lightweight hierarchical tracing shared by all the tools.
+//
+// Tracing is off unless the PARAM_TRACE environment variable is set:
+//   PARAM_TRACE=summary            flat per-phase summary on stderr
+//   PARAM_TRACE=chrome[:file.json] Chrome trace (chrome://tracing, Perfetto)
+// When off, a TRACE_SCOPE costs one predictable branch.
+//
+// Every thread keeps its own phase stack, so scopes may be opened inside
+// OpenMP regions. The phases of a worker thread are recorded under the
+// phase the first thread (the one that first traced) was in when the worker
+// opened its outermost scope, and carry their own tid in the Chrome trace.
+// Allocation counts are process wide: a phase overlapping other threads
+// also counts their allocations.
+//
+// The peak resident size of a phase is the peak of the process so far
+// (ru_maxrss when the phase ends), not the phase's own: a phase after a
+// larger one reports the larger one's peak. A phase raised the peak only
+// if it reports more than the phases that ended before it.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+namespace trace {
+
+namespace detail {
+
+inline std::atomic<bool> &counting()
+{
+    static std::atomic<bool> flag(false);
+    return flag;
+}
+
+inline std::atomic<long long> &alloc_count()
+{
+    static std::atomic<long long> count(0);
+    return count;
+}
+
+inline std::atomic<long long> &alloc_bytes()
+{
+    static std::atomic<long long> bytes(0);
+    return bytes;
+}
+
+// called by the operator new hooks in trace_alloc.hpp
+inline void count_alloc(std::size_t n)
+{
+    if (counting().load(std::memory_order_relaxed)) {
+        alloc_count().fetch_add(1, std::memory_order_relaxed);
+        alloc_bytes().fetch_add((long long)n, std::memory_order_relaxed);
+    }
+}
+
+inline long peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // kilobytes on linux
+}
+
+inline double now_us()
+{
+    using namespace std::chrono;
+    static const steady_clock::time_point origin = steady_clock::now();
+    return duration<double, std::micro>(steady_clock::now() - origin).count();
+}
+
+struct Event {
+    std::string path;     // phase path, e.g. "slim/solve"
+    std::string name;
+    int tid;
+    double start_us;
+    double dur_us;
+    long peak_rss_kb;     // process peak when the phase ended, see above
+    long long allocs;
+    long long alloc_bytes;
+    bool counter;
+    double value;
+};
+
+class Tracer {
+public:
+    enum Mode { OFF, SUMMARY, CHROME };
+
+    static Tracer &get()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return mode != OFF; }
+
+    void push(const char *name)
+    {
+        ThreadStack &t = thread_stack();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (t.tid == 0) t.tid = ++threads;
+        if (t.stack.empty()) t.base = t.tid == 1 ? std::string() : main_path;
+        t.stack.push_back(name);
+        if (t.tid == 1) main_path = current_path(t);
+    }
+
+    void pop(const char *name, double start_us, long long allocs, long long bytes)
+    {
+        ThreadStack &t = thread_stack();
+        std::lock_guard<std::mutex> lock(mutex);
+        Event e;
+        e.path = current_path(t);
+        e.name = name;
+        e.tid = t.tid;
+        e.start_us = start_us;
+        e.dur_us = now_us() - start_us;
+        e.peak_rss_kb = peak_rss_kb();
+        e.allocs = allocs;
+        e.alloc_bytes = bytes;
+        e.counter = false;
+        e.value = 0.0;
+        events.push_back(e);
+        if (!t.stack.empty()) t.stack.pop_back();
+        if (t.tid == 1) main_path = current_path(t);
+    }
+
+    void counter(const char *name, double value)
+    {
+        ThreadStack &t = thread_stack();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (t.tid == 0) t.tid = ++threads;
+        // a worker outside any scope of its own counts under the main phase
+        const std::string path = t.stack.empty() && t.tid != 1 ? main_path : current_path(t);
+        Event e;
+        e.path = path.empty() ? std::string(name) : path + "/" + name;
+        e.name = name;
+        e.tid = t.tid;
+        e.start_us = now_us();
+        e.dur_us = 0.0;
+        e.peak_rss_kb = 0;
+        e.allocs = 0;
+        e.alloc_bytes = 0;
+        e.counter = true;
+        e.value = value;
+        events.push_back(e);
+    }
+
+    ~Tracer() { flush(); }
+
+    void flush()
+    {
+        if (mode == OFF || flushed) return;
+        flushed = true;
+        if (mode == CHROME) write_chrome();
+        else write_summary();
+    }
+
+private:
+    Tracer() : mode(OFF), flushed(false)
+    {
+        const char *env = std::getenv("PARAM_TRACE");
+        if (env == NULL || env[0] == '\0' || std::strcmp(env, "0") == 0) return;
+
+        if (std::strncmp(env, "chrome", 6) == 0) {
+            mode = CHROME;
+            output = (env[6] == ':') ? std::string(env + 7) : std::string("trace.json");
+        } else {
+            mode = SUMMARY;
+        }
+        now_us(); // pin the time origin
+        counting().store(true);
+    }
+
+    struct ThreadStack {
+        std::vector<const char *> stack;
+        std::string base;   // main thread phase when the outermost scope opened
+        int tid = 0;        // 1 for the first thread that traces
+    };
+
+    static ThreadStack &thread_stack()
+    {
+        thread_local ThreadStack t;
+        return t;
+    }
+
+    static std::string current_path(const ThreadStack &t)
+    {
+        std::string path = t.base;
+        for (std::size_t i = 0; i < t.stack.size(); i++) {
+            if (!path.empty()) path += "/";
+            path += t.stack[i];
+        }
+        return path;
+    }
+
+    void write_chrome()
+    {
+        FILE *out = fopen(output.c_str(), "w");
+        if (out == NULL) {
+            fprintf(stderr, "IOError: %s could not be opened for writing...\n", output.c_str());
+            return;
+        }
+        fprintf(out, "{\"traceEvents\":[\n");
+        for (std::size_t i = 0; i < events.size(); i++) {
+            const Event &e = events[i];
+            if (e.counter) {
+                fprintf(out, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                             "\"args\":{\"value\":%.17g}}",
+                        e.name.c_str(), e.start_us, e.tid, e.value);
+            } else {
+                fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+                             "\"args\":{\"path\":\"%s\",\"process_peak_rss_kb\":%ld,\"allocs\":%lld,\"alloc_bytes\":%lld}}",
+                        e.name.c_str(), e.start_us, e.dur_us, e.tid, e.path.c_str(),
+                        e.peak_rss_kb, e.allocs, e.alloc_bytes);
+            }
+            fprintf(out, i + 1 < events.size() ? ",\n" : "\n");
+        }
+        fprintf(out, "]}\n");
+        fclose(out);
+    }
+
+    void write_summary()
+    {
+        struct Row { int calls; double ms; long rss; long long allocs; long long bytes; double value; bool counter; };
+        std::map<std::string, Row> rows;
+        for (const Event &e : events) {
+            Row &r = rows[e.path];
+            r.calls++;
+            r.ms += e.dur_us / 1000.0;
+            r.rss = std::max(r.rss, e.peak_rss_kb);
+            r.allocs += e.allocs;
+            r.bytes += e.alloc_bytes;
+            r.value = e.value;
+            r.counter = e.counter;
+        }
+        fprintf(stderr, "%-40s %8s %12s %17s %12s %14s\n",
+                "phase", "calls", "time [ms]", "process peak [MB]", "allocs", "alloc [MB]");
+        for (const auto &it : rows) {
+            const Row &r = it.second;
+            if (r.counter) {
+                fprintf(stderr, "%-40s %8d %12.17g\n", it.first.c_str(), r.calls, r.value);
+            } else {
+                fprintf(stderr, "%-40s %8d %12.3f %17.1f %12lld %14.1f\n",
+                        it.first.c_str(), r.calls, r.ms, r.rss / 1024.0,
+                        r.allocs, r.bytes / (1024.0 * 1024.0));
+            }
+        }
+    }
+
+    Mode mode;
+    bool flushed;
+    std::string output;
+    std::mutex mutex;
+    int threads = 0;
+    std::string main_path;  // current phase of thread 1, the base of the workers
+    std::vector<Event> events;
+};
+
+} // namespace detail
+
+inline bool enabled()
+{
+    return detail::Tracer::get().enabled();
+}
+
+// records a named value (iteration count, energy, ...) under the current phase
+inline void counter(const char *name, double value)
+{
+    if (enabled()) detail::Tracer::get().counter(name, value);
+}
+
+// times the enclosing block; phases nest into a path like "slim/solve"
+class Scope {
+public:
+    explicit Scope(const char *name) : name(name), active(enabled())
+    {
+        if (!active) return;
+        allocs = detail::alloc_count().load(std::memory_order_relaxed);
+        bytes = detail::alloc_bytes().load(std::memory_order_relaxed);
+        detail::Tracer::get().push(name);
+        start = detail::now_us();
+    }
+
+    ~Scope()
+    {
+        if (!active) return;
+        detail::Tracer::get().pop(name, start,
+            detail::alloc_count().load(std::memory_order_relaxed) - allocs,
+            detail::alloc_bytes().load(std::memory_order_relaxed) - bytes);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name;
+    bool active;
+    double start = 0.0;
+    long long allocs = 0;
+    long long bytes = 0;
+};
+
+} // namespace trace
@@ -0,0 +1,58 @@
+#pragma once
+
+// Global allocation hooks feeding the per-phase allocation counts of trace.hpp.
+// Include this header in exactly one translation unit per executable (the main).
+// Phases may be opened on any thread; the counts are process wide.
+//
+// The hooks replace the global operator new and delete, so they are only
+// compiled in with -DTRACE_ALLOC=ON (PARAMETRIZATION_TRACE_ALLOC); otherwise
+// this header adds nothing and the allocation columns of the trace stay 0.
+
+#include <cstdlib>
+#include <new>
+
+#include "trace.hpp"
+
+#ifdef PARAMETRIZATION_TRACE_ALLOC
+
+namespace trace {
+namespace detail {
+
+// malloc, retried through the new handler like the default operator new
+inline void *allocate(std::size_t n)
+{
+    count_alloc(n);
+    for (;;) {
+        if (void *p = std::malloc(n ? n : 1)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) throw std::bad_alloc();
+        handler();
+    }
+}
+
+inline void *allocate(std::size_t n, const std::nothrow_t &) noexcept
+{
+    try {
+        return allocate(n);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+} // namespace detail
+} // namespace trace
+
+void *operator new(std::size_t n) { return trace::detail::allocate(n); }
+void *operator new[](std::size_t n) { return trace::detail::allocate(n); }
+void *operator new(std::size_t n, const std::nothrow_t &tag) noexcept { return trace::detail::allocate(n, tag); }
+void *operator new[](std::size_t n, const std::nothrow_t &tag) noexcept { return trace::detail::allocate(n, tag); }
+
+// every form of delete ends in the unsized one
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { ::operator delete(p); }
+void operator delete(void *p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void *p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { ::operator delete(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { ::operator delete(p); }
+
+#endif
@@ -0,0 +1,224 @@
+#pragma once
+
+// Global overlap detection for uv layouts. Local flips are not enough: a free
+// boundary can fold over another part of the chart while every face stays
+// positively oriented. A 2D bounding volume hierarchy over the uv triangles
+// is traversed in parallel, one query per triangle, and candidate pairs are
+// tested exactly with separating axes. Triangles that only touch (shared
+// edges or vertices of a valid mesh) do not count as overlapping.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "trace.hpp"
+
+
+namespace overlap {
+
+struct Box {
+    double lo[2], hi[2];
+
+    bool intersects(const Box &b) const
+    {
+        return lo[0] <= b.hi[0] && b.lo[0] <= hi[0] && lo[1] <= b.hi[1] && b.lo[1] <= hi[1];
+    }
+    void merge(const Box &b)
+    {
+        for (int d = 0; d < 2; d++) {
+            lo[d] = std::min(lo[d], b.lo[d]);
+            hi[d] = std::max(hi[d], b.hi[d]);
+        }
+    }
+};
+
+struct Node {
+    Box box;
+    int left;           // child nodes, or -1 for a leaf
+    int right;
+    int begin, end;     // range of the leaf in the triangle order
+};
+
+// Binary tree over triangle boxes, median split on the longest axis
+class BVH {
+public:
+    static const int leaf_size = 4;
+
+    void build(const std::vector<Box> &boxes)
+    {
+        this->boxes = &boxes;
+        order.resize(boxes.size());
+        std::iota(order.begin(), order.end(), 0);
+        centers.resize(boxes.size());
+        for (std::size_t i = 0; i < boxes.size(); i++) {
+            centers[i][0] = 0.5 * (boxes[i].lo[0] + boxes[i].hi[0]);
+            centers[i][1] = 0.5 * (boxes[i].lo[1] + boxes[i].hi[1]);
+        }
+        nodes.clear();
+        nodes.reserve(2 * boxes.size() / leaf_size + 2);
+        if (!boxes.empty()) build(0, boxes.size());
+        // leaf boxes stored contiguously for the queries
+        sorted.resize(boxes.size());
+        for (std::size_t k = 0; k < boxes.size(); k++) sorted[k] = boxes[order[k]];
+    }
+
+    int size() const { return order.size(); }
+    // triangle at position k of the leaf order
+    int item(int k) const { return order[k]; }
+
+    // calls visit(k) for every position k > after whose box intersects
+    // query; querying each position with after = itself visits every pair once
+    template <typename Visit>
+    void query(const Box &query, int after, Visit visit) const
+    {
+        if (nodes.empty()) return;
+        int stack[128];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes[stack[--top]];
+            if (node.end <= after + 1 || !node.box.intersects(query)) continue;
+            if (node.left < 0) {
+                for (int k = std::max(node.begin, after + 1); k < node.end; k++) {
+                    if (sorted[k].intersects(query)) visit(k);
+                }
+            } else {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+    }
+
+private:
+    int build(int begin, int end)
+    {
+        int index = nodes.size();
+        nodes.push_back(Node());
+        Box box = (*boxes)[order[begin]];
+        for (int k = begin + 1; k < end; k++) box.merge((*boxes)[order[k]]);
+        nodes[index].box = box;
+        nodes[index].begin = begin;
+        nodes[index].end = end;
+
+        if (end - begin <= leaf_size) {
+            nodes[index].left = nodes[index].right = -1;
+            return index;
+        }
+        int axis = box.hi[0] - box.lo[0] >= box.hi[1] - box.lo[1] ? 0 : 1;
+        int mid = (begin + end) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+        int left = build(begin, mid);
+        int right = build(mid, end);
+        nodes[index].left = left;
+        nodes[index].right = right;
+        return index;
+    }
+
+    const std::vector<Box> *boxes = nullptr;
+    std::vector<std::array<double, 2>> centers;
+    std::vector<int> order;
+    std::vector<Box> sorted;
+    std::vector<Node> nodes;
+};
+
+// true if the interiors of the triangles a and b intersect; touching
+// (within eps) does not count. A triangle with two coincident corners is
+// tested as the segment it has collapsed to.
+inline bool triangles_overlap(const Eigen::Vector2d a[3], const Eigen::Vector2d b[3], double eps)
+{
+    const Eigen::Vector2d *tri[2] = { a, b };
+    for (int t = 0; t < 2; t++) {
+        for (int e = 0; e < 3; e++) {
+            Eigen::Vector2d edge = tri[t][(e + 1) % 3] - tri[t][e];
+            // a collapsed edge has no normal, its projections would all be 0
+            if (edge.x() == 0.0 && edge.y() == 0.0) continue;
+            Eigen::Vector2d axis(-edge.y(), edge.x());
+            double amin = INFINITY, amax = -INFINITY, bmin = INFINITY, bmax = -INFINITY;
+            for (int i = 0; i < 3; i++) {
+                double pa = axis.dot(a[i]), pb = axis.dot(b[i]);
+                amin = std::min(amin, pa);
+                amax = std::max(amax, pa);
+                bmin = std::min(bmin, pb);
+                bmax = std::max(bmax, pb);
+            }
+            double tol = eps * axis.norm();
+            if (amax <= bmin + tol || bmax <= amin + tol) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace overlap
+
+
+struct OverlapResult {
+    long long pairs = 0;                // overlapping face pairs
+    std::vector<int> faces;             // faces involved in some overlap, sorted
+};
+
+// UV: uv coordinates, FUV: uv faces (F for per vertex uvs)
+inline OverlapResult find_uv_overlaps(const Eigen::Ref<const Eigen::MatrixXd> &UV, const Eigen::Ref<const Eigen::MatrixXi> &FUV)
+{
+    using namespace overlap;
+    TRACE_SCOPE("overlap");
+    const int nf = FUV.rows();
+
+    std::vector<Box> boxes(nf);
+    double extent = 0.0;
+    #pragma omp parallel for reduction(max:extent)
+    for (int f = 0; f < nf; f++) {
+        Box &box = boxes[f];
+        for (int d = 0; d < 2; d++) {
+            box.lo[d] = std::min(UV(FUV(f, 0), d), std::min(UV(FUV(f, 1), d), UV(FUV(f, 2), d)));
+            box.hi[d] = std::max(UV(FUV(f, 0), d), std::max(UV(FUV(f, 1), d), UV(FUV(f, 2), d)));
+            extent = std::max(extent, box.hi[d] - box.lo[d]);
+        }
+    }
+    // touching within a tiny fraction of the largest face is not an overlap
+    const double eps = 1e-9 * extent;
+
+    BVH bvh;
+    {
+        TRACE_SCOPE("bvh");
+        bvh.build(boxes);
+    }
+
+    // queries in leaf order are spatially coherent; every thread lists the
+    // faces it finds and the lists are merged at the end
+    OverlapResult result;
+    long long pairs = 0;
+    #pragma omp parallel reduction(+:pairs)
+    {
+        std::vector<int> involved;
+        #pragma omp for schedule(dynamic, 256) nowait
+        for (int p = 0; p < nf; p++) {
+            const int f = bvh.item(p);
+            Eigen::Vector2d a[3];
+            for (int i = 0; i < 3; i++) a[i] = UV.row(FUV(f, i)).head<2>().transpose();
+            bvh.query(boxes[f], p, [&](int k) {
+                const int g = bvh.item(k);
+                Eigen::Vector2d b[3];
+                for (int i = 0; i < 3; i++) b[i] = UV.row(FUV(g, i)).head<2>().transpose();
+                if (triangles_overlap(a, b, eps)) {
+                    pairs++;
+                    involved.push_back(f);
+                    involved.push_back(g);
+                }
+            });
+        }
+        #pragma omp critical
+        result.faces.insert(result.faces.end(), involved.begin(), involved.end());
+    }
+
+    result.pairs = pairs;
+    std::sort(result.faces.begin(), result.faces.end());
+    result.faces.erase(std::unique(result.faces.begin(), result.faces.end()), result.faces.end());
+    trace::counter("overlapping_pairs", pairs);
+    return result;
+}
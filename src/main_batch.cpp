@@ -0,0 +1,468 @@
+// Batch runner for job directories on a shared filesystem. Any number of
+// workers, on one or more hosts, drain the same directory:
+//
+//   <jobs>/queue/NAME.job            waiting; one command line per job
+//   <jobs>/queue/.NAME.job.tmp.PID   being submitted; not a job yet
+//   <jobs>/claimed/NAME.job@WORKER   running; the mtime is the heartbeat
+//   <jobs>/done/NAME.job             exit code 0
+//   <jobs>/failed/NAME.job           any other exit code
+//   <jobs>/logs/NAME.log             stdout and stderr of the last attempt
+//
+// A job is claimed by renaming it from queue/ to claimed/, which succeeds for
+// exactly one worker. While the job runs the worker touches its claim; a
+// claim whose heartbeat is older than --stale seconds belongs to a dead
+// worker and is renamed back to queue/ (again by exactly one worker). The
+// outcome is appended to the job file as a comment line before it is moved
+// to done/ or failed/. Commands run in the job directory, so relative paths
+// in job files refer to it; the tools write their outputs atomically.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "atomic_output.hpp"
+#include "options.hpp"
+
+using namespace std;
+
+
+static const char *subdirs[] = { "queue", "claimed", "done", "failed", "logs" };
+
+static std::atomic<int> stop_signal(0);
+static std::atomic<pid_t> running_child(0);
+
+// first signal: stop claiming and pass it on to the running job; second: default
+static void on_signal(int sig)
+{
+    stop_signal = sig;
+    pid_t child = running_child;
+    if (child > 0) kill(child, sig);
+    signal(sig, SIG_DFL);
+}
+
+static bool ends_with(const std::string &name, const std::string &suffix)
+{
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// "NAME.job", not a temporary file of a submit in progress
+static bool is_job(const std::string &name) { return ends_with(name, ".job"); }
+
+// "NAME.job@WORKER"
+static bool is_claim(const std::string &name) { return name.find(".job@") != std::string::npos; }
+
+static std::vector<std::string> list_dir(const std::string &dir, bool (*keep)(const std::string &))
+{
+    std::vector<std::string> names;
+    DIR *d = opendir(dir.c_str());
+    if (d == NULL) return names;
+    while (struct dirent *e = readdir(d)) {
+        std::string name(e->d_name);
+        if (name[0] == '.') continue;
+        if (!keep(name)) continue;
+        names.push_back(name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+static bool make_layout(const std::string &jobs)
+{
+    mkdir(jobs.c_str(), 0777);
+    for (const char *sub : subdirs) {
+        std::string path = jobs + "/" + sub;
+        if (mkdir(path.c_str(), 0777) != 0 && errno != EEXIST) {
+            std::cerr << "Error! Cannot create " << path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string default_worker_id()
+{
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    return std::string(host) + "-" + std::to_string(getpid());
+}
+
+// the clock of the file server, which stamps the heartbeats: touches a probe
+// file in the jobs directory and reads its mtime back, so a host whose clock
+// is off neither requeues live claims nor keeps dead ones. Falls back to the
+// local clock if the directory is not writable.
+static time_t server_time(const std::string &jobs)
+{
+    std::string probe = jobs + "/.clock-" + default_worker_id();
+    struct stat st;
+    int fd = open(probe.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) return time(NULL);
+    close(fd);
+    bool stamped = utimes(probe.c_str(), NULL) == 0 && stat(probe.c_str(), &st) == 0;
+    unlink(probe.c_str());
+    return stamped ? st.st_mtime : time(NULL);
+}
+
+static double age_seconds(const std::string &path, time_t now)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return -1.0;
+    return difftime(now, st.st_mtime);
+}
+
+// "NAME.job@WORKER" -> NAME.job
+static std::string job_of_claim(const std::string &claim)
+{
+    return claim.substr(0, claim.rfind('@'));
+}
+
+static std::string worker_of_claim(const std::string &claim)
+{
+    std::size_t at = claim.rfind('@');
+    return at == std::string::npos ? "" : claim.substr(at + 1);
+}
+
+// first line that is not a comment, split on blanks; "..." groups words
+static std::vector<std::string> read_command(const std::string &path)
+{
+    std::ifstream in(path);
+    std::string line;
+    std::vector<std::string> args;
+    while (std::getline(in, line)) {
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        std::string word;
+        bool quoted = false, pending = false;
+        for (std::size_t i = first; i < line.size(); i++) {
+            char c = line[i];
+            if (c == '"') {
+                quoted = !quoted;
+                pending = true;
+            } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+                if (pending) args.push_back(word);
+                word.clear();
+                pending = false;
+            } else {
+                word += c;
+                pending = true;
+            }
+        }
+        if (pending) args.push_back(word);
+        break;
+    }
+    return args;
+}
+
+// last "# exit ..." line appended by a worker
+static std::string last_outcome(const std::string &path)
+{
+    std::ifstream in(path);
+    std::string line, outcome;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 7, "# exit ") == 0) outcome = line.substr(2);
+    }
+    return outcome;
+}
+
+// puts the claims of dead workers back in the queue; returns how many
+static int requeue_stale(const std::string &jobs, double stale_seconds)
+{
+    int requeued = 0;
+    std::vector<std::string> claims = list_dir(jobs + "/claimed", is_claim);
+    if (claims.empty()) return 0;
+    const time_t now = server_time(jobs);
+    for (const std::string &claim : claims) {
+        std::string path = jobs + "/claimed/" + claim;
+        double age = age_seconds(path, now);
+        if (age < stale_seconds) continue;
+        std::string back = jobs + "/queue/" + job_of_claim(claim);
+        if (rename(path.c_str(), back.c_str()) == 0) {
+            std::cerr << "Warning: requeued " << job_of_claim(claim) << ", worker "
+                      << worker_of_claim(claim) << " silent for " << (int)age << "s" << std::endl;
+            requeued++;
+        }
+    }
+    return requeued;
+}
+
+// touches the claim every `interval` seconds until stopped
+class Heartbeat {
+public:
+    Heartbeat(const std::string &path, double interval)
+        : path(path), interval(interval), thread(&Heartbeat::loop, this) {}
+
+    ~Heartbeat()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+private:
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, std::chrono::duration<double>(interval), [this] { return done; })) {
+            utimes(path.c_str(), NULL);
+        }
+    }
+
+    std::string path;
+    double interval;
+    bool done = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+};
+
+// runs args in dir with stdout and stderr sent to log; returns the exit code,
+// 128 + signal if killed, 127 if it could not be started
+static int run_command(const std::vector<std::string> &args, const std::string &dir,
+                       const std::string &log, const std::string &bin)
+{
+    std::string program = args[0];
+    if (program.find('/') == std::string::npos && !bin.empty()) {
+        std::string candidate = bin + "/" + program;
+        if (access(candidate.c_str(), X_OK) == 0) program = candidate;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) return 127;
+    if (pid == 0) {
+        // own process group: a terminal ^C reaches the runner only, which passes it on once
+        setpgid(0, 0);
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd >= 0) {
+            dup2(fd, 1);
+            dup2(fd, 2);
+            close(fd);
+        }
+        if (chdir(dir.c_str()) != 0) _exit(127);
+        std::vector<char *> argv;
+        argv.push_back(const_cast<char *>(program.c_str()));
+        for (std::size_t i = 1; i < args.size(); i++) argv.push_back(const_cast<char *>(args[i].c_str()));
+        argv.push_back(NULL);
+        execvp(argv[0], argv.data());
+        fprintf(stderr, "Cannot run %s: %s\n", program.c_str(), strerror(errno));
+        _exit(127);
+    }
+
+    running_child = pid;
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    running_child = 0;
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 127;
+}
+
+static std::string absolute_dir(const std::string &path)
+{
+    char resolved[PATH_MAX];
+    return realpath(path.c_str(), resolved) != NULL ? std::string(resolved) : path;
+}
+
+static int submit(int argc, char *argv[])
+{
+    // batch submit <jobs> <name> <tool> [args...], arguments are taken verbatim
+    if (argc < 5) {
+        std::cerr << "Usage: batch submit jobs_dir name tool [args...]" << std::endl;
+        return 1;
+    }
+    std::string jobs(argv[2]);
+    if (!make_layout(jobs)) return 1;
+    std::string path = jobs + "/queue/" + argv[3] + ".job";
+    // hidden while it is written, workers skip dot files
+    AtomicOutput output(path, jobs + "/queue/." + argv[3] + ".job.tmp." + std::to_string(getpid()));
+    FILE *out = fopen(output.temp_path().c_str(), "w");
+    if (out == NULL) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return 1;
+    }
+    for (int i = 4; i < argc; i++) {
+        bool quote = strchr(argv[i], ' ') != NULL || argv[i][0] == '\0';
+        fprintf(out, i > 4 ? (quote ? " \"%s\"" : " %s") : (quote ? "\"%s\"" : "%s"), argv[i]);
+    }
+    fprintf(out, "\n");
+    return output.commit(AtomicOutput::close(out)) ? 0 : 1;
+}
+
+static int status(const std::string &jobs, double stale_seconds)
+{
+    std::vector<std::string> queued = list_dir(jobs + "/queue", is_job);
+    std::vector<std::string> claimed = list_dir(jobs + "/claimed", is_claim);
+    std::vector<std::string> done = list_dir(jobs + "/done", is_job);
+    std::vector<std::string> failed = list_dir(jobs + "/failed", is_job);
+
+    std::map<std::string, int> per_worker;
+    int stale = 0;
+    const time_t now = server_time(jobs);
+    for (const std::string &claim : claimed) {
+        if (age_seconds(jobs + "/claimed/" + claim, now) >= stale_seconds) stale++;
+        else per_worker[worker_of_claim(claim)]++;
+    }
+
+    printf("queued:  %d\n", (int)queued.size());
+    printf("running: %d (%d workers)\n", (int)claimed.size() - stale, (int)per_worker.size());
+    printf("stale:   %d\n", stale);
+    printf("done:    %d\n", (int)done.size());
+    printf("failed:  %d\n", (int)failed.size());
+    for (const auto &w : per_worker) printf("  worker %s: %d\n", w.first.c_str(), w.second);
+    for (const std::string &claim : claimed) {
+        double age = age_seconds(jobs + "/claimed/" + claim, now);
+        if (age >= stale_seconds) {
+            printf("  stale %s (%s, %ds)\n", job_of_claim(claim).c_str(), worker_of_claim(claim).c_str(), (int)age);
+        }
+    }
+    for (const std::string &name : failed) {
+        printf("  failed %s: %s\n", name.c_str(), last_outcome(jobs + "/failed/" + name).c_str());
+    }
+    return failed.empty() ? 0 : 2;
+}
+
+static int run(const std::string &jobs, const Options &opts, const std::string &bin)
+{
+    if (!make_layout(jobs)) return 1;
+    const std::string worker = opts.get("worker", default_worker_id());
+    const double heartbeat = opts.get_double("heartbeat", 10.0);
+    const double stale_seconds = opts.get_double("stale", 120.0);
+    const int max_jobs = opts.get_int("max-jobs", 0);
+    const bool wait = opts.has("wait");
+    if (stale_seconds < 3.0 * heartbeat) {
+        std::cerr << "Warning: --stale should be several --heartbeat intervals, or live jobs get requeued" << std::endl;
+    }
+    if (worker.find('@') != std::string::npos || worker.find('/') != std::string::npos) {
+        std::cerr << "Error! Worker ids cannot contain '@' or '/'" << std::endl;
+        return 1;
+    }
+
+    signal(SIGTERM, on_signal);
+    signal(SIGINT, on_signal);
+
+    // workers start at different positions of the queue to avoid racing for the same job
+    std::size_t offset = std::hash<std::string>()(worker);
+    int ran = 0, failures = 0;
+    while (stop_signal == 0 && (max_jobs <= 0 || ran < max_jobs)) {
+        requeue_stale(jobs, stale_seconds);
+
+        std::vector<std::string> queued = list_dir(jobs + "/queue", is_job);
+        std::string job, claim;
+        for (std::size_t i = 0; i < queued.size() && job.empty(); i++) {
+            const std::string &name = queued[(offset + i) % queued.size()];
+            std::string path = jobs + "/claimed/" + name + "@" + worker;
+            if (rename((jobs + "/queue/" + name).c_str(), path.c_str()) == 0) {
+                job = name;
+                claim = path;
+            }
+        }
+        if (job.empty()) {
+            // with --wait, stay until no claim of another worker may go stale
+            if (wait && (!queued.empty() || !list_dir(jobs + "/claimed", is_claim).empty())) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(std::min(heartbeat, 5.0)));
+                continue;
+            }
+            break;
+        }
+        utimes(claim.c_str(), NULL);
+
+        const std::string name = job.substr(0, job.size() - 4);
+        std::vector<std::string> args = read_command(claim);
+        std::cout << worker << ": " << name << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        int code;
+        if (args.empty()) {
+            code = 127;
+        } else {
+            Heartbeat beat(claim, heartbeat);
+            code = run_command(args, jobs, jobs + "/logs/" + name + ".log", bin);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (stop_signal != 0) {
+            // interrupted: give the job back, tools resume from their checkpoints
+            rename(claim.c_str(), (jobs + "/queue/" + job).c_str());
+            std::cerr << "Warning: " << name << " interrupted and requeued" << std::endl;
+            break;
+        }
+        ran++;
+
+        // a claim taken away as stale is finished by whoever requeued it
+        if (access(claim.c_str(), F_OK) != 0) {
+            std::cerr << "Warning: lost the claim on " << name << ", result discarded" << std::endl;
+            continue;
+        }
+        FILE *record = fopen(claim.c_str(), "a");
+        if (record != NULL) {
+            fprintf(record, "# exit %d worker %s seconds %0.1f\n", code, worker.c_str(), seconds);
+            fclose(record);
+        }
+        std::string target = jobs + (code == 0 ? "/done/" : "/failed/") + job;
+        if (rename(claim.c_str(), target.c_str()) != 0) {
+            std::cerr << "Warning: cannot record the result of " << name << std::endl;
+        }
+        if (code != 0) {
+            failures++;
+            std::cerr << "Warning: " << name << " failed with exit code " << code << std::endl;
+        }
+    }
+
+    std::cout << worker << ": " << ran << " jobs, " << failures << " failed" << std::endl;
+    return failures > 0 ? 2 : 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && std::string(argv[1]) == "submit") {
+        return submit(argc, argv);
+    }
+
+    const std::string usage =
+        "Usage: batch run jobs_dir [--worker id] [--heartbeat 10] [--stale 120] [--max-jobs N] [--wait] [--bin dir]\n"
+        "       batch status jobs_dir [--stale 120]\n"
+        "       batch submit jobs_dir name tool [args...]";
+    Options opts(argc, argv, {"worker", "heartbeat", "stale", "max-jobs", "bin"}, {"wait"});
+    if (!opts.check(usage)) return 1;
+    if (opts.size() < 2 || (opts[0] != "run" && opts[0] != "status")) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    std::string jobs = absolute_dir(opts[1]);
+
+    if (opts[0] == "status") {
+        return status(jobs, opts.get_double("stale", 120.0));
+    }
+
+    // tools are looked up next to this executable unless --bin says otherwise
+    std::string self(argv[0]);
+    std::string bin = opts.get("bin", self.find('/') == std::string::npos ? "" : absolute_dir(self.substr(0, self.rfind('/'))));
+    return run(jobs, opts, bin);
+}
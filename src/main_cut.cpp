@@ -1,190 +1,157 @@
-
-#include <CGAL/Simple_cartesian.h>
-#include <CGAL/Polyhedron_3.h>
-#include <CGAL/Surface_mesh.h>
-#include <CGAL/boost/graph/Seam_mesh.h>
-#include <CGAL/Surface_mesh_parameterization/IO/File_off.h>
-#include <CGAL/Surface_mesh_parameterization/parameterize.h>
-#include <CGAL/Surface_mesh_parameterization/Square_border_parameterizer_3.h>
-#include <CGAL/Surface_mesh_parameterization/Barycentric_mapping_parameterizer_3.h>
-#include <CGAL/Unique_hash_map.h>
-#include <CGAL/Polygon_mesh_processing/measure.h>
-#include <CGAL/Inverse_index.h>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <vector>
 
-#include <CGAL/Surface_mesh_parameterization/ARAP_parameterizer_3.h>
-
-// #include <CGAL/IO/OFF_reader.h>
-
-#include <CGAL/Surface_mesh_parameterization/internal/Containers_filler.h>
-#include <CGAL/Polygon_mesh_processing/connected_components.h>
-
-
-typedef CGAL::Simple_cartesian<double> Kernel;
-typedef Kernel::Point_2                Point_2;
-typedef Kernel::Point_3                Point_3;
-typedef CGAL::Polyhedron_3<Kernel>     PolyMesh;
-
-typedef boost::graph_traits<PolyMesh>::edge_descriptor     SM_edge_descriptor;
-typedef boost::graph_traits<PolyMesh>::halfedge_descriptor SM_halfedge_descriptor;
-typedef boost::graph_traits<PolyMesh>::vertex_descriptor   SM_vertex_descriptor;
-
-typedef CGAL::Unique_hash_map<SM_edge_descriptor, bool> Seam_edge_uhm;
-typedef boost::associative_property_map<Seam_edge_uhm>  Seam_edge_pmap;
-
-typedef CGAL::Unique_hash_map<SM_vertex_descriptor, bool> Seam_vertex_uhm;
-typedef boost::associative_property_map<Seam_vertex_uhm>  Seam_vertex_pmap;
-
-typedef CGAL::Unique_hash_map<SM_halfedge_descriptor, Point_2> UV_uhm;
-typedef boost::associative_property_map<UV_uhm>                UV_pmap;
-
-typedef CGAL::Seam_mesh<PolyMesh, Seam_edge_pmap, Seam_vertex_pmap> SeamMesh;
-
-typedef boost::graph_traits<SeamMesh>::vertex_descriptor   vertex_descriptor;
-typedef boost::graph_traits<SeamMesh>::halfedge_descriptor halfedge_descriptor;
-typedef boost::graph_traits<SeamMesh>::face_descriptor     face_descriptor;
-
-typedef boost::unordered_map<vertex_descriptor, std::size_t> Vertex_index_map;
-
-namespace SMP = CGAL::Surface_mesh_parameterization;
-
-typedef SMP::Square_border_uniform_parameterizer_3<SeamMesh>  Border_parameterizer;
-typedef SMP::Barycentric_mapping_parameterizer_3<SeamMesh, Border_parameterizer> Parameterizer;
-
+#include "atomic_output.hpp"
+#include "off_input.hpp"
+#include "options.hpp"
+#include "parametrization.hpp"
+#include "puv_output.hpp"
+#include "result_cache.hpp"
+#include "trace_alloc.hpp"
 
-struct Compute_area:
-  public std::unary_function<const PolyMesh::Facet, double>
-{
-  double operator()(const PolyMesh::Facet& f) const{
-    return Kernel::Compute_area_3()(
-      f.halfedge()->vertex()->point(),
-      f.halfedge()->next()->vertex()->point(),
-      f.halfedge()->opposite()->vertex()->point() );
-  }
-};
-
-void write_obj(std::ofstream &out, SeamMesh &mesh, UV_pmap &uv_pm);
-void check_facets_area(SeamMesh &mesh, UV_pmap &uv_pm, halfedge_descriptor &bhd);
+Eigen::MatrixXi read_seams(const std::string &path);
+void write_obj(std::ofstream &out, const parametrization::Chart &chart);
 
 int main(int argc, char** argv)
 {
-        if (argc < 3) {
+    Options opts(argc, argv, {"arap-iterations", "arap-tolerance", "rank", "binary-bits"}, {"arap"});
+    if (!opts.check("Usage: cut mesh.off seams.txt [seams.txt ...] [--rank dirichlet|conformal|area]\n"
+                    "       [--arap [--arap-iterations 100] [--arap-tolerance 1e-6]] [--binary-bits N]")) {
+        return 1;
+    }
+    if (opts.size() < 2) {
         std::cerr << "ERROR! Files name missing." << std::endl;
         return 1;
     }
 
-    std::string file(argv[1]);
-    std::ifstream in(argv[1]);
-    if(!in) {
-        std::cerr << "Problem loading the input data" << std::endl;
-        return EXIT_FAILURE;
-    }
+    std::string file(opts[0]);
+    TRACE_SCOPE("cut");
+    std::string out_file = file.substr(0, file.size()-4) + "_cut.obj";
+
+    // every seam file after the mesh is a candidate cut, only the best one
+    // by --rank is written
+    parametrization::CutOptions options;
+    options.arap = opts.has("arap");
+    options.arap_iterations = opts.get_int("arap-iterations", 100);
+    options.arap_tolerance = opts.get_double("arap-tolerance", 1e-6);
+    options.rank = opts.get("rank", "dirichlet");
+    std::vector<std::string> seam_files;
+    for (std::size_t c = 1; c < opts.size(); c++) seam_files.push_back(opts[c]);
+
+    // every option that changes the output is part of the key, the
+    // tolerance with all its digits
+    std::ostringstream params;
+    params.precision(17);
+    if (options.arap) params << "arap " << options.arap_iterations << " " << options.arap_tolerance;
+    if (seam_files.size() > 1) params << " rank " << options.rank;
+    ResultCache cache("cut", params.str());
+    cache.add_file(file);
+    for (const std::string &seams : seam_files) cache.add_file(seams);
+    if (!opts.has("binary-bits") && cache.fetch(out_file)) return EXIT_SUCCESS;
 
     // read mesh
-    PolyMesh sm;
-    in >> sm;
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    std::vector<Eigen::MatrixXi> seams;
+    {
+        TRACE_SCOPE("load");
+        if (!read_off(file, V, F)) {
+            std::cerr << "Problem loading the input data" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (F.rows() == 0) {
+            std::cerr << "Empty mesh, your model might not be manifold." << std::endl;
+            return 1;
+        }
+        for (const std::string &path : seam_files) seams.push_back(read_seams(path));
+    }
+    trace::counter("vertices", V.rows());
+    trace::counter("faces", F.rows());
 
-    if (sm.empty()) {
-        std::cerr << "Empty Polyhedron, your model might not be manifold." << std::endl;
+    std::vector<parametrization::Chart> charts;
+    std::vector<int> order;
+    if (!parametrization::cut_candidates(V, F, seams, charts, order, options)) {
         return 1;
     }
 
-    // create seam mesh object
-    Seam_edge_uhm seam_edge_uhm(false);
-    Seam_edge_pmap seam_edge_pm(seam_edge_uhm);
-
-    Seam_vertex_uhm seam_vertex_uhm(false);
-    Seam_vertex_pmap seam_vertex_pm(seam_vertex_uhm);
-
-    SeamMesh mesh(sm, seam_edge_pm, seam_vertex_pm);
-
-    // read seam from file
-    const char* filename = argv[2];
-    SM_halfedge_descriptor smhd = mesh.add_seams(filename);
-    if(smhd == SM_halfedge_descriptor() ) {
-        std::cerr << "Warning: No seams in input" << std::endl;
+    if (seam_files.size() > 1) {
+        printf("%4s %7s %10s %10s %10s %10s  %s\n", "rank", "flips", "degenerate", "dirichlet", "conformal", "area", "seams");
+        for (std::size_t r = 0; r < order.size(); r++) {
+            const parametrization::Chart &chart = charts[order[r]];
+            printf("%4zu %7d %10d %10.4f %10.4f %10.4f  %s\n", r + 1, chart.flips, chart.degenerate,
+                   chart.symmetric_dirichlet, chart.conformal, chart.area, seam_files[order[r]].c_str());
+        }
+        for (std::size_t c = 0; c < seam_files.size(); c++) {
+            if (std::find(order.begin(), order.end(), (int)c) == order.end()) {
+                printf("%4s %7s %10s %10s %10s %10s  %s\n", "-", "-", "-", "-", "-", "-", seam_files[c].c_str());
+            }
+        }
     }
-
-    // A halfedge on the (possibly virtual) border
-    halfedge_descriptor bhd = CGAL::Polygon_mesh_processing::longest_border(mesh, CGAL::Polygon_mesh_processing::parameters::all_default()).first;
-
-    // create parametrization map
-    UV_uhm uv_uhm;
-    UV_pmap uv_pm(uv_uhm);
-
-    // parametrization
-    Parameterizer param = Parameterizer();
-    SMP::parameterize(mesh, param, bhd, uv_pm);
+    const parametrization::Chart &best = charts[order[0]];
 
     // save mesh parametrized
-    std::string out_file = file.substr(0, file.size()-4) + "_cut.obj";
-    std::ofstream out(out_file);
-    write_obj(out, mesh, uv_pm);
+    {
+        TRACE_SCOPE("export");
+        AtomicOutput output(out_file);
+        std::ofstream out(output.temp_path());
+        write_obj(out, best);
+        out.close();
+        if (!output.commit(!out.fail())) return 1;
+    }
+    cache.store(out_file);
+    if (opts.has("binary-bits")) {
+        TRACE_SCOPE("export_binary");
+        if (!write_binary_output(out_file, opts.get_int("binary-bits", 16), best.V, best.F, best.uv, best.F)) {
+            return 1;
+        }
+    }
 
-    check_facets_area(mesh, uv_pm, bhd);
+    if (best.null_faces > 0) {
+        std::cerr << "WARNING: " << best.null_faces << " faces have 0 area!" << std::endl;
+    }
 
     return EXIT_SUCCESS;
 
 }
 
-void write_obj(std::ofstream &out, SeamMesh &mesh, UV_pmap &uv_pm)
+// vertex pairs, one seam edge each; an unreadable file has no seams
+Eigen::MatrixXi read_seams(const std::string &path)
 {
-    Vertex_index_map vium;
-    boost::associative_property_map<Vertex_index_map> vimap(vium);
-    std::size_t vertices_counter = 0, faces_counter = 0;
-
-    // save vertices and texture coordinates
-    boost::property_map<SeamMesh, CGAL::vertex_point_t>::type vpm = get(CGAL::vertex_point, mesh);
-    boost::graph_traits<SeamMesh>::vertex_iterator vb, ve;
-    for(boost::tie(vb, ve) = vertices(mesh); vb != ve; ++vb)
-    {
-        vertex_descriptor vd = *vb;
-        halfedge_descriptor hd = halfedge(vd, mesh);
+    std::ifstream in(path);
+    std::vector<int> ids;
+    int s, t;
+    while (in >> s >> t) {
+        ids.push_back(s);
+        ids.push_back(t);
+    }
+    Eigen::MatrixXi seams(ids.size() / 2, 2);
+    for (int i = 0; i < seams.rows(); i++) seams.row(i) << ids[2 * i], ids[2 * i + 1];
+    return seams;
+}
 
-        auto pt = get(vpm, target(hd, mesh));
-        //auto pt = get(vpm, source(hd, mesh));
-        auto uv = get(uv_pm, hd);
-        out << "v "  << pt << std::endl;
-        out << "vt " << -(uv.x()* 2.0 - 1.0) << " " << (uv.y()* 2.0 - 1.0) << std::endl;
+void write_obj(std::ofstream &out, const parametrization::Chart &chart)
+{
+    const Eigen::MatrixXd &V = chart.V, &uv = chart.uv;
+    const Eigen::MatrixXi &F = chart.F;
 
-        // set index to vertices
-        put(vimap, vd, vertices_counter++);
+    // save vertices and texture coordinates
+    for (int i = 0; i < V.rows(); i++) {
+        out << "v "  << V(i, 0) << " " << V(i, 1) << " " << V(i, 2) << '\n';
+        out << "vt " << uv(i, 0) << " " << uv(i, 1) << '\n';
     }
 
     // faces
-    BOOST_FOREACH(face_descriptor fd, faces(mesh)) {
-        halfedge_descriptor hd = halfedge(fd, mesh);
+    for (int f = 0; f < F.rows(); f++) {
         out << "f";
-        BOOST_FOREACH(vertex_descriptor vd, vertices_around_face(hd, mesh)){
-            auto idx = get(vimap, vd) + 1;
+        for (int k = 0; k < 3; k++) {
+            int idx = F(f, k) + 1;
             out << " " << idx << "/" << idx << "/" << idx;
         }
-        out << std::endl;
-    }
-}
-
-
-void check_facets_area(SeamMesh &mesh, UV_pmap &uv_pm, halfedge_descriptor &bhd)
-{
-    std::stringstream out;
-    SMP::IO::output_uvmap_to_off(mesh, bhd, uv_pm, out);
-
-    PolyMesh tmp;
-    out >> tmp;
-
-    Compute_area ca;
-    std::size_t num_null_faces = 0;
-
-    for (auto it = tmp.facets_begin(); it != tmp.facets_end(); it++) {
-        if (ca(*it) == 0.0) {
-            num_null_faces++;
-        }
+        out << '\n';
     }
-
-    if (num_null_faces > 0) {
-        std::cerr << "WARNING: " << num_null_faces << " faces have 0 area!" << std::endl;
-    }
-
 }
@@ -1,85 +1,64 @@
-
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
-#include <CGAL/Simple_cartesian.h>
-#include <CGAL/Surface_mesh.h>
-#include <boost/variant.hpp>
-#include <boost/lexical_cast.hpp>
-#include <CGAL/boost/graph/dijkstra_shortest_paths.h>
-
-typedef CGAL::Simple_cartesian<double>      Kernel;
-typedef CGAL::Surface_mesh<Kernel::Point_3> Triangle_mesh;
-typedef boost::graph_traits<Triangle_mesh>  Graph_traits;
-typedef Graph_traits::vertex_descriptor     vertex_descriptor;
-
-typedef std::vector<vertex_descriptor>                  VertexDescriptorList;
-typedef std::map<vertex_descriptor, int>                VertexIndexMap;
-typedef boost::associative_property_map<VertexIndexMap> VertexIdPropertyMap;
+#include <vector>
 
-typedef boost::iterator_property_map<VertexDescriptorList::iterator, VertexIdPropertyMap> PredecessorMap;
-typedef boost::iterator_property_map<std::vector<double>::iterator, VertexIdPropertyMap>  DistanceMap;
+#include "atomic_output.hpp"
+#include "off_input.hpp"
+#include "options.hpp"
+#include "parametrization.hpp"
+#include "trace_alloc.hpp"
 
 
 int main(int argc, char** argv)
 {
-    if (argc < 3) {
+    Options opts(argc, argv, {"reorder"});
+    if (!opts.check("Usage: dijkstra_seam mesh.off selection.txt [--reorder rcm|morton]")) return 1;
+    if (opts.size() < 2) {
         std::cerr << "ERROR: need to specify .off and selection files" << std::endl;
         return 1;
     }
-    
+
+    TRACE_SCOPE("dijkstra_seam");
+
     // read mesh
-    Triangle_mesh tmesh;
-    std::ifstream input(argv[1]);
-    input >> tmesh;
-    input.close();
-    
-    VertexIndexMap vertex_id_map;
-    VertexIdPropertyMap vertex_index_pmap(vertex_id_map);
-    int index = 0;
-    for(vertex_descriptor vd : vertices(tmesh)) {
-        vertex_id_map[vd] = index++;
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    {
+        TRACE_SCOPE("load");
+        if (!read_off(opts[0], V, F)) {
+            std::cerr << "Problem loading the input data" << std::endl;
+            return 1;
+        }
     }
-    
-    input.open(argv[2]);
+    trace::counter("vertices", V.rows());
 
-    std::ofstream out(std::string(argv[1])+".selection.txt");
+    // (start, end) vertex pairs, in the input order also with --reorder
+    std::vector<int> ids;
+    std::ifstream selection(opts[1]);
+    int start, end;
+    while (selection >> start >> end) {
+        ids.push_back(start);
+        ids.push_back(end);
+    }
+    Eigen::MatrixXi endpoints(ids.size() / 2, 2);
+    for (int i = 0; i < endpoints.rows(); i++) endpoints.row(i) << ids[2 * i], ids[2 * i + 1];
+    trace::counter("paths", endpoints.rows());
+
+    Eigen::MatrixXi seams;
+    if (!parametrization::seam_paths(V, F, endpoints, seams, opts.get("reorder", ""))) {
+        return 1;
+    }
+
+    // every path from its end to its start, one seam edge per vertex pair
+    AtomicOutput output(opts[0] + ".selection.txt");
+    std::ofstream out(output.temp_path());
     out << std::endl << std::endl;
-    
-    while (!input.eof()) {
-        
-        int start, end;
-        input >> start >> end;
-        
-        vertex_descriptor vstart(start);
-        vertex_descriptor vend(end);
-        
-        // We first declare a vector
-        std::vector<vertex_descriptor> predecessor(num_vertices(tmesh));
-        // and then turn it into a property map
-        std::vector<double> distance(num_vertices(tmesh));
-        PredecessorMap predecessor_pmap(predecessor.begin(), vertex_index_pmap);
-        DistanceMap distance_pmap(distance.begin(), vertex_index_pmap);
-        
-        boost::dijkstra_shortest_paths(tmesh, vstart,
-                                 distance_map(distance_pmap)
-                                 .predecessor_map(predecessor_pmap)
-                                 .vertex_index_map(vertex_index_pmap));
-        
-        vertex_descriptor it = vend;
-        
-        out << vertex_id_map[it] << " ";
-        it = boost::get(predecessor_pmap, it);
-        
-        while (it != vstart) {
-            out << vertex_id_map[it] << " " << vertex_id_map[it] << " ";
-            it = boost::get(predecessor_pmap, it);
-        }
-        out << vertex_id_map[it] << " ";
-        
+    for (int e = 0; e < seams.rows(); e++) {
+        out << seams(e, 0) << " " << seams(e, 1) << " ";
     }
-    input.close();
-    
+    out.close();
+    if (!output.commit(!out.fail())) return 1;
 
     return 0;
 }
@@ -0,0 +1,70 @@
+#include <iostream>
+
+#include <igl/readOBJ.h>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "distortion.hpp"
+#include "options.hpp"
+#include "trace_alloc.hpp"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    const std::string usage = "Usage: distortion mesh_uv.obj [--per-face singular_values.txt]";
+    Options opts(argc, argv, {"per-face"});
+    if (!opts.check(usage)) return 1;
+    if (opts.size() < 1) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    std::string file(opts[0]);
+    TRACE_SCOPE("distortion");
+
+    Eigen::MatrixXd V, TC, N;
+    Eigen::MatrixXi F, FTC, FN;
+    {
+        TRACE_SCOPE("load");
+        if (!igl::readOBJ(file, V, TC, N, F, FTC, FN)) {
+            std::cerr << "Problem loading the input data" << std::endl;
+            return 1;
+        }
+    }
+    trace::counter("vertices", V.rows());
+    trace::counter("faces", F.rows());
+
+    if (TC.rows() == 0) {
+        std::cerr << "ERROR! " << file << " has no texture coordinates." << std::endl;
+        return 1;
+    }
+    if (FTC.rows() != F.rows()) FTC = F;
+
+    const bool per_face = opts.has("per-face");
+    DistortionStats stats;
+    {
+        TRACE_SCOPE("evaluate");
+        stats = compute_distortion(V, F, TC, FTC, per_face);
+    }
+    print_distortion(stdout, stats);
+
+    if (per_face) {
+        TRACE_SCOPE("export");
+        std::string out_file = opts.get("per-face", "");
+        if (out_file.empty()) out_file = file.substr(0, file.size()-4) + "_sv.txt";
+        FILE *out = fopen(out_file.c_str(), "w");
+        if (out == NULL) {
+            std::cerr << "Cannot write " << out_file << std::endl;
+            return 1;
+        }
+        for (int f = 0; f < stats.singular_values.rows(); f++) {
+            fprintf(out, "%0.17g %0.17g\n", stats.singular_values(f, 0), stats.singular_values(f, 1));
+        }
+        fclose(out);
+    }
+
+    return stats.flips > 0 ? 2 : 0;
+}
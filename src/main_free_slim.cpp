@@ -1,213 +1,151 @@
 #include <iostream>
 
-#include <igl/slim.h>
-
-#include <igl/vertex_components.h>
 #include <igl/readOBJ.h>
-#include <igl/writeOBJ.h>
-#include <igl/Timer.h>
-
-#include <igl/boundary_loop.h>
-#include <igl/map_vertices_to_circle.h>
-#include <igl/harmonic.h>
-#include <igl/MappingEnergyType.h>
-#include <igl/serialize.h>
-#include <igl/read_triangle_mesh.h>
-#include <igl/opengl/glfw/Viewer.h>
-#include <igl/flipped_triangles.h>
-#include <igl/euler_characteristic.h>
-#include <igl/barycenter.h>
-#include <igl/adjacency_matrix.h>
-#include <igl/is_edge_manifold.h>
-#include <igl/doublearea.h>
-#include <igl/cat.h>
-#include <igl/PI.h>
 
 #include <stdlib.h>
 
 #include <string>
-#include <vector>
-
-using namespace std;
-using namespace Eigen;
-
-void check_mesh_for_issues(Eigen::MatrixXd& V, Eigen::MatrixXi& F);
-void writeOBJ(const std::string str,
-    const Eigen::MatrixXd& V,
-    const Eigen::MatrixXi& F,
-    const Eigen::MatrixXd& TC,
-    const Eigen::MatrixXi& FTC);
-
 
-Eigen::MatrixXd V;
-Eigen::MatrixXi F;
-bool first_iter = true;
-igl::SLIMData sData;
-igl::Timer timer;
+#include "checkpoint.hpp"
+#include "distortion.hpp"
+#include "incremental.hpp"
+#include "obj_output.hpp"
+#include "options.hpp"
+#include "parametrization.hpp"
+#include "puv_output.hpp"
+#include "run_budget.hpp"
+#include "trace_alloc.hpp"
+#include "uv_overlap.hpp"
 
-double uv_scale_param;
 
 int main(int argc, char *argv[])
 {
-    if (argc < 2) {
-        std::cerr << "Missing obj file" << std::endl;
+    Options opts(argc, argv, {"checkpoint-every", "engine", "time-budget", "init", "reorder", "previous", "rings", "partitions", "binary-bits"},
+                 {"float", "resume", "distortion", "check-overlap"});
+    if (!opts.check("Usage: freeslim mesh.obj [fresh] [--engine slim|newton|slim+newton] [--init harmonic|conformal] [--float]\n"
+                    "       [--partitions K] [--reorder rcm|morton] [--checkpoint-every 50] [--resume] [--time-budget SECONDS]\n"
+                    "       [--previous result.obj [--rings 2]] [--distortion] [--check-overlap] [--binary-bits N]")) {
         return 1;
     }
-    std::string file(argv[1]);
-
-    bool init = true;
-    if (argc > 2) {
-        init = false;
+    if (opts.size() < 1) {
+        std::cerr << "Missing obj file" << std::endl;
+        return 1;
     }
+    std::string file(opts[0]);
+    parametrization::SlimOptions options;
+    options.iterations = 1000;
+    options.fixed_boundary = false;
+    options.init = opts.get("init", "harmonic");
+    options.engine = opts.get("engine", "slim");
+    options.single_precision = opts.has("float");
+    options.partitions = opts.get_int("partitions", 1);
+    options.reorder = opts.get("reorder", "");
+    options.checkpoint = file.substr(0, file.size()-4) + "_freeslim.ckpt";
+    options.checkpoint_every = opts.get_int("checkpoint-every", 50);
+    options.resume = opts.has("resume");
+    // deadline for the whole run, and SIGTERM / SIGINT stop the solver gracefully
+    run_budget().start(opts.get_double("time-budget", 0.0));
+    TRACE_SCOPE("freeslim");
+    const std::string out_file = file.substr(0, file.size()-4) + "_freeslim.obj";
 
 
     Eigen::MatrixXd V, TC, N;
     Eigen::MatrixXi F,FTC,FN;
-    igl::readOBJ(file, V, TC, N, F, FTC, FN);
-
-    Eigen::MatrixXd uv_init;
-    Eigen::VectorXi bnd; Eigen::MatrixXd bnd_uv;
-    igl::boundary_loop(F,bnd);
-
-
-    if (TC.rows() > 0 && init) {
-        std::cout << "Use obj parametrization as init" << std::endl;
+    {
+        TRACE_SCOPE("load");
+        igl::readOBJ(file, V, TC, N, F, FTC, FN);
+    }
+    trace::counter("vertices", V.rows());
+    trace::counter("faces", F.rows());
+
+    // the uv of the obj is the initialization, unless a second argument asks
+    // for a fresh one
+    Eigen::MatrixXd uv = Eigen::MatrixXd::Zero(V.rows(), 2);
+    if (TC.rows() > 0 && FTC.rows() == F.rows()) {
+        uv = uv_per_vertex(V.rows(), F, TC, FTC);
+        options.use_input = opts.size() < 2;
+    }
 
-        // put all boundary
-        std::vector<int> idx;
-        for (int i = 0; i < TC.rows(); i++){
-            if (TC.row(i).squaredNorm() - 1.0 < 0.00001) {
-                idx.push_back(i);
-            }
+    if (opts.has("previous")) {
+        // re-solve only around the edit, see incremental.hpp
+        Eigen::MatrixXd V_prev, TC_prev, N_prev;
+        Eigen::MatrixXi F_prev, FTC_prev, FN_prev;
+        {
+            TRACE_SCOPE("load_previous");
+            igl::readOBJ(opts.get("previous", ""), V_prev, TC_prev, N_prev, F_prev, FTC_prev, FN_prev);
         }
-
-        bnd_uv.resize(idx.size(), 2);
-        uv_init.resize(TC.rows(), 2);
-
-        for (int i = 0; i< idx.size(); i++) {
-            bnd_uv.row(i) = TC.row(idx[i]);
+        if (TC_prev.rows() == 0 || FTC_prev.rows() != F_prev.rows()) {
+            std::cerr << "Error! Previous result has no texture coordinates" << std::endl;
+            return 1;
         }
 
-        for (int i = 0; i < TC.rows(); i++) {
-            uv_init.row(i) = TC.row(i);
+        if (!parametrization::slim_incremental(V, F, V_prev, F_prev, uv_per_vertex(V_prev.rows(), F_prev, TC_prev, FTC_prev),
+                                               uv, options, opts.get_int("rings", 2))) {
+            return 1;
         }
 
-    } else {
-        std::cout << "Start from harmonic param" << std::endl;
-
-        igl::map_vertices_to_circle(V,bnd,bnd_uv);
-
-        igl::harmonic(V,F,bnd,bnd_uv,1,uv_init);
-        if (igl::flipped_triangles(uv_init,F).size() != 0) {
-            igl::harmonic(F,bnd,bnd_uv,1,uv_init); // use uniform laplacian
+        std::cout << out_file << std::endl;
+        {
+            TRACE_SCOPE("export");
+            if (!writeOBJ(out_file, V, F, uv, F)) {
+                return 1;
+            }
+        }
+        if (opts.has("binary-bits") && !write_binary_output(out_file, opts.get_int("binary-bits", 16), V, F, uv, F)) {
+            return 1;
         }
+        return 0;
     }
 
-
-    cout << "initialized parametrization" << endl;
-    double soft_const_p = 0;
-    sData.slim_energy = igl::MappingEnergyType::SYMMETRIC_DIRICHLET;
-    slim_precompute(V, F, uv_init, sData, igl::MappingEnergyType::SYMMETRIC_DIRICHLET, bnd, bnd_uv, soft_const_p);
-    cout << "energy = " << sData.energy << endl;
-    slim_solve(sData, 1000); // 1000 iter
-
-    cout << "energy = " << sData.energy << endl;
-
-    Eigen::MatrixXd empty(0, 3);
-    const std::string out_file = file.substr(0, file.size()-4) + "_freeslim.obj";
-    std::cout << out_file << std::endl;
-    writeOBJ(out_file, V, F, sData.V_o, F);
-
-  return 0;
-}
-
-void check_mesh_for_issues(Eigen::MatrixXd& V, Eigen::MatrixXi& F) {
-
-  Eigen::SparseMatrix<double> A;
-  igl::adjacency_matrix(F,A);
-
-  Eigen::MatrixXi C, Ci;
-  igl::vertex_components(A, C, Ci);
-
-  int connected_components = Ci.rows();
-  if (connected_components!=1) {
-    cout << "Error! Input has multiple connected components" << endl; exit(1);
-  }
-  int euler_char = igl::euler_characteristic(V, F);
-  if (euler_char!=1)
-  {
-    cout <<
-      "Error! Input does not have a disk topology, it's euler char is " <<
-      euler_char << endl;
-    exit(1);
-  }
-  bool is_edge_manifold = igl::is_edge_manifold(F);
-  if (!is_edge_manifold) {
-    cout << "Error! Input is not an edge manifold" << endl; exit(1);
-  }
-
-  Eigen::VectorXd areas; igl::doublearea(V,F,areas);
-  const double eps = 1e-14;
-  for (int i = 0; i < areas.rows(); i++) {
-    if (areas(i) < eps) {
-      cout << "Error! Input has zero area faces" << endl; exit(1);
+    parametrization::SlimResult result;
+    if (!parametrization::slim(V, F, uv, options, result)) {
+        return 1;
     }
-  }
-}
 
-
-void writeOBJ(const std::string str,
-  const Eigen::MatrixXd& V,
-  const Eigen::MatrixXi& F,
-  const Eigen::MatrixXd& TC,
-  const Eigen::MatrixXi& FTC)
-{
-    FILE * obj_file = fopen(str.c_str(),"w");
-    if(NULL==obj_file)
-    {
-        printf("IOError: %s could not be opened for writing...",str.c_str());
-        return;
+    if (opts.has("distortion")) {
+        TRACE_SCOPE("distortion");
+        print_distortion(stdout, compute_distortion(V, F, uv));
     }
-    // Loop over V
-    for(int i = 0;i<(int)V.rows();i++)
-    {
-        fprintf(obj_file,"v");
-        for(int j = 0;j<(int)V.cols();++j)
-        {
-            fprintf(obj_file," %0.17g", V(i,j));
+
+    // a free boundary can fold over the chart without flipping any face
+    long long overlaps = -1;
+    if (opts.has("check-overlap")) {
+        overlaps = find_uv_overlaps(uv, F).pairs;
+        if (overlaps > 0) {
+            std::cerr << "Warning: " << overlaps << " overlapping face pairs in the parametrization" << std::endl;
         }
-        fprintf(obj_file,"\n");
     }
-    bool write_N = false;
-
 
-    bool write_texture_coords = TC.rows() >0;
-
-    if(write_texture_coords)
+    std::cout << out_file << std::endl;
     {
-        for(int i = 0;i<(int)TC.rows();i++)
-        {
-            fprintf(obj_file, "vt %0.17g %0.17g\n",TC(i,0),TC(i,1));
+        TRACE_SCOPE("export");
+        if (!writeOBJ(out_file, V, F, uv, F)) {
+            return 1;
         }
-        fprintf(obj_file,"\n");
+    }
+    if (opts.has("binary-bits") && !write_binary_output(out_file, opts.get_int("binary-bits", 16), V, F, uv, F)) {
+        return 1;
     }
 
-    // loop over F
-    for(int i = 0;i<(int)F.rows();++i)
-    {
-        fprintf(obj_file,"f");
-        for(int j = 0; j<(int)F.cols();++j)
-        {
-          // OBJ is 1-indexed
-          fprintf(obj_file," %u",F(i,j)+1);
-
-          if(write_texture_coords)
-            fprintf(obj_file,"/%u",FTC(i,j)+1);
-
-        }
-        fprintf(obj_file,"\n");
+    // partial runs keep their checkpoint so they can be resumed
+    RunReport report;
+    report.tool = "freeslim";
+    report.output = out_file;
+    report.iterations = result.iterations - result.first_iteration;
+    report.requested_iterations = options.iterations - result.first_iteration;
+    report.energy = result.energy;
+    report.flips = result.flips;
+    report.overlaps = overlaps;
+    report.write(out_file.substr(0, out_file.size()-4) + ".report.json");
+    if (run_budget().stopped()) {
+        std::cerr << "Warning: partial result written to " << out_file << std::endl;
+    } else {
+        remove_slim_checkpoint(options.checkpoint);
     }
-    fclose(obj_file);
 
+    // the result is written anyway, so it can be inspected
+    if (overlaps > 0) {
+        return 2;
+    }
+    return 0;
 }
-
@@ -3,30 +3,12 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <CGAL/Simple_cartesian.h>
-#include <CGAL/Surface_mesh.h>
-#include <CGAL/Surface_mesh_shortest_path.h>
-#include <CGAL/IO/OBJ_reader.h>
-#include <CGAL/Polygon_mesh_processing/measure.h>
 #include "args/args.hxx"
-
-
-typedef CGAL::Simple_cartesian<double>      Kernel;
-typedef CGAL::Surface_mesh<Kernel::Point_3> Triangle_mesh;
-typedef CGAL::Surface_mesh_shortest_path_traits<Kernel, Triangle_mesh> Traits;
-typedef CGAL::Surface_mesh_shortest_path<Traits> Surface_mesh_shortest_path;
-typedef Traits::Barycentric_coordinates BaryCoord;
-
-typedef boost::graph_traits<Triangle_mesh> Graph_traits;
-typedef Graph_traits::vertex_descriptor    vertex_descriptor;
-typedef Graph_traits::vertex_iterator      vertex_iterator;
-typedef Graph_traits::face_iterator        face_iterator;
-
-typedef std::vector<int> IntList;
-typedef std::vector<double> DoubleList;
-typedef std::vector<BaryCoord> BarycentricList;
-
-namespace PMP = CGAL::Polygon_mesh_processing;
+#include "atomic_output.hpp"
+#include "off_input.hpp"
+#include "parametrization.hpp"
+#include "result_cache.hpp"
+#include "trace_alloc.hpp"
 
 
 int main(int argc, char** argv) {
@@ -37,6 +19,7 @@ int main(int argc, char** argv) {
     args::Positional<std::string> query_arg(parser, "query",  "Query files");
     args::Positional<std::string> out_arg(parser, "output", "Output file");
     args::Flag normalize(parser, "normalize", "Normalize geodesic distance", {'n', "normalize"});
+    args::ValueFlag<std::string> reorder(parser, "method", "Reorder vertices and faces for locality (rcm or morton)", {"reorder"});
 
 
     // Parse args
@@ -54,95 +37,73 @@ int main(int argc, char** argv) {
     std::string mesh_path    = args::get(mesh_arg);
     std::string queries_path = args::get(query_arg);
     std::string output_file  = args::get(out_arg);
+    TRACE_SCOPE("geodesic");
 
-    // read mesh
-    Triangle_mesh mesh;
-    std::ifstream input(mesh_path);
-    input >> mesh;
-    input.close();
+    // the reordering changes the rounding of the distances
+    ResultCache cache("geodesic", std::string(normalize ? "normalize" : "") + " reorder=" +
+                                  (reorder ? args::get(reorder) : ""));
+    cache.add_file(mesh_path);
+    cache.add_file(queries_path);
+    if (cache.fetch(output_file)) return 0;
 
-    // if(!CGAL::IO::read_polygon_mesh(input_mesh, mesh) || !CGAL::is_triangle_mesh(mesh))
-    if(!CGAL::is_triangle_mesh(mesh))
+    // read mesh
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
     {
-        std::cerr << "Invalid input file." << std::endl;
-        return EXIT_FAILURE;
-    }
-    std::cout << "NF " << num_faces(mesh) <<std::endl;
-    std::cout << "NV " << num_vertices(mesh) <<std::endl;
-
-    double norm_factor = 1.0;
-    if (normalize) {
-        norm_factor = std::sqrt(PMP::area(mesh));
+        TRACE_SCOPE("load");
+        if (!read_off(mesh_path, V, F) || (F.array() < 0).any())
+        {
+            std::cerr << "Invalid input file." << std::endl;
+            return EXIT_FAILURE;
+        }
     }
+    std::cout << "NF " << F.rows() <<std::endl;
+    std::cout << "NV " << V.rows() <<std::endl;
 
-    // prepare containers for query points
-    IntList face_idx_s;
-    IntList face_idx_t;
-    BarycentricList barycentrics_s;
-    BarycentricList barycentrics_t;
-
-    // read query points
-    int fidx_s, fidx_t;
-    double w0_s, w1_s, w2_s;
-    double w0_t, w1_t, w2_t;
-    std::ifstream evaluation_file(queries_path);
-
-    while (evaluation_file >> fidx_s >> w0_s >> w1_s >> w2_s >> fidx_t >> w0_t >> w1_t >> w2_t) {
-        face_idx_s.push_back(fidx_s);
-        face_idx_t.push_back(fidx_t);
-        barycentrics_s.push_back(BaryCoord({w0_s, w1_s, w2_s}));
-        barycentrics_t.push_back(BaryCoord({w0_t, w1_t, w2_t}));
-
-        if (w0_s + w1_s + w2_s - 1.0 > 1.0e-4) {
-            std::cerr << "Error! One of the barycentric coordinates does not sum up to 1. \nTerminating!" << std::endl;
-            return 1;
-        }
-        if (w0_t + w1_t + w2_t - 1.0 > 1.0e-4) {
-            std::cerr << "Error! One of the barycentric coordinates does not sum up to 1. \nTerminating!" << std::endl;
-            return 1;
+    // read query points: face and barycentric coordinates of the source,
+    // then of the target; face indices refer to the input order
+    std::vector<int> faces_s, faces_t;
+    std::vector<double> bary_s, bary_t;
+    {
+        TRACE_SCOPE("read_queries");
+        std::ifstream evaluation_file(queries_path);
+        int fidx_s, fidx_t;
+        double w0_s, w1_s, w2_s;
+        double w0_t, w1_t, w2_t;
+        while (evaluation_file >> fidx_s >> w0_s >> w1_s >> w2_s >> fidx_t >> w0_t >> w1_t >> w2_t) {
+            faces_s.push_back(fidx_s);
+            faces_t.push_back(fidx_t);
+            bary_s.insert(bary_s.end(), {w0_s, w1_s, w2_s});
+            bary_t.insert(bary_t.end(), {w0_t, w1_t, w2_t});
         }
     }
-    evaluation_file.close();
-    std::cout << "Found " << face_idx_s.size() << " num of query points" << std::endl;
-
-    // construct a shortest path query object and add a source point
-    Surface_mesh_shortest_path shortest_paths(mesh);
-
-    // iterate over all points
-    DoubleList distances;
-    for (uint i = 0; i < face_idx_s.size(); i++) {
-        int fidx_t       = face_idx_t[i];
-        int fidx_s       = face_idx_s[i];
-        BaryCoord bary_s = barycentrics_s[i];
-        BaryCoord bary_t = barycentrics_t[i];
-
-        // create an iterator of faces
-        face_iterator face_it_s = faces(mesh).first;
-        // move it to the target face
-        std::advance(face_it_s, fidx_s);
-        // add the query point as source
-        shortest_paths.add_source_point(*face_it_s, bary_s);
-
-        // create an iterator of faces
-        face_iterator face_it_t = faces(mesh).first;
-        // move it to the target face
-        // std::advance(face_it_t, 0);
-        std::advance(face_it_t, fidx_t);
-
-        // compute shortest path distance
-        auto result = shortest_paths.shortest_distance_to_source_points(*face_it_t, bary_t);
-        distances.push_back(result.first / norm_factor);
-
-        // // remove query point
-        shortest_paths.remove_all_source_points();
+    const int nq = faces_s.size();
+    std::cout << "Found " << nq << " num of query points" << std::endl;
+    trace::counter("num_queries", nq);
+
+    // one query per row
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> BaryRows;
+    Eigen::VectorXd distances(nq);
+    if (!parametrization::geodesic_distances(V, F, Eigen::Map<Eigen::VectorXi>(faces_s.data(), nq),
+                                             Eigen::Map<BaryRows>(bary_s.data(), nq, 3),
+                                             Eigen::Map<Eigen::VectorXi>(faces_t.data(), nq),
+                                             Eigen::Map<BaryRows>(bary_t.data(), nq, 3),
+                                             distances, args::get(normalize), reorder ? args::get(reorder) : "")) {
+        return 1;
     }
 
     // save distance to file
-    std::ofstream outstream(output_file);
-    for (uint i = 0; i < distances.size() ; i++) {
-        outstream << distances[i] << std::endl;
+    {
+        TRACE_SCOPE("export");
+        AtomicOutput output(output_file);
+        std::ofstream outstream(output.temp_path());
+        for (int i = 0; i < nq; i++) {
+            outstream << distances(i) << std::endl;
+        }
+        outstream.close();
+        if (!output.commit(!outstream.fail())) return 1;
     }
-    outstream.close();
+    cache.store(output_file);
 
     return 0;
 }
@@ -1,187 +1,191 @@
 #include <iostream>
 
-#include <igl/slim.h>
-
-#include <igl/vertex_components.h>
 #include <igl/readOBJ.h>
-#include <igl/writeOBJ.h>
-#include <igl/Timer.h>
-
-#include <igl/boundary_loop.h>
-#include <igl/map_vertices_to_circle.h>
-#include <igl/harmonic.h>
-#include <igl/MappingEnergyType.h>
-#include <igl/serialize.h>
-#include <igl/read_triangle_mesh.h>
-#include <igl/opengl/glfw/Viewer.h>
-#include <igl/flipped_triangles.h>
-#include <igl/euler_characteristic.h>
-#include <igl/barycenter.h>
-#include <igl/adjacency_matrix.h>
-#include <igl/is_edge_manifold.h>
-#include <igl/doublearea.h>
-#include <igl/cat.h>
-#include <igl/PI.h>
 
 #include <stdlib.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
-using namespace std;
-using namespace Eigen;
-
-void check_mesh_for_issues(Eigen::MatrixXd& V, Eigen::MatrixXi& F);
-void writeOBJ(const std::string str,
-    const Eigen::MatrixXd& V,
-    const Eigen::MatrixXi& F,
-    const Eigen::MatrixXd& TC,
-    const Eigen::MatrixXi& FTC);
-
-
-Eigen::MatrixXd V;
-Eigen::MatrixXi F;
-bool first_iter = true;
-igl::SLIMData sData;
-igl::Timer timer;
+#include "checkpoint.hpp"
+#include "distortion.hpp"
+#include "incremental.hpp"
+#include "obj_output.hpp"
+#include "options.hpp"
+#include "parametrization.hpp"
+#include "puv_output.hpp"
+#include "run_budget.hpp"
+#include "sequence.hpp"
+#include "trace_alloc.hpp"
 
-double uv_scale_param;
 
 int main(int argc, char *argv[])
 {
-    if (argc < 2) {
+    Options opts(argc, argv, {"checkpoint-every", "engine", "time-budget", "reorder", "previous", "rings", "sequence", "frame-iterations", "partitions", "binary-bits"},
+                 {"hard-bnd", "float", "resume", "distortion"});
+    if (!opts.check("Usage: slim_bnd mesh.obj [--engine slim|newton|slim+newton] [--hard-bnd] [--float] [--partitions K]\n"
+                    "       [--reorder rcm|morton] [--checkpoint-every 50] [--resume] [--time-budget SECONDS]\n"
+                    "       [--previous result.obj [--rings 2]] [--sequence frames.txt [--frame-iterations 10]]\n"
+                    "       [--distortion] [--binary-bits N]")) {
+        return 1;
+    }
+    if (opts.size() < 1) {
         std::cerr << "Missing obj file" << std::endl;
         return 1;
     }
-    std::string file(argv[1]);
+    std::string file(opts[0]);
+    parametrization::SlimOptions options;
+    options.iterations = 100;
+    options.engine = opts.get("engine", "slim");
+    options.libigl = !opts.has("hard-bnd");
+    options.single_precision = opts.has("float");
+    options.partitions = opts.get_int("partitions", 1);
+    options.reorder = opts.get("reorder", "");
+    options.checkpoint = file.substr(0, file.size()-4) + "_slim.ckpt";
+    options.checkpoint_every = opts.get_int("checkpoint-every", 50);
+    options.resume = opts.has("resume");
+    // deadline for the whole run, and SIGTERM / SIGINT stop the solver gracefully
+    run_budget().start(opts.get_double("time-budget", 0.0));
+    TRACE_SCOPE("slim_bnd");
+    const std::string out_file = file.substr(0, file.size()-4) + "_slim.obj";
 
 
     Eigen::MatrixXd V, TC, N;
     Eigen::MatrixXi F,FTC,FN;
-    igl::readOBJ(file, V, TC, N, F, FTC, FN);
-
-    Eigen::MatrixXd uv_init;
-    Eigen::VectorXi bnd; Eigen::MatrixXd bnd_uv;
-    Eigen::VectorXi b; Eigen::MatrixXd bc;
-    igl::boundary_loop(F,bnd);
-
-    // collect boundary uv into bnd_uv
-    bnd_uv.conservativeResize(bnd.rows(), 2);
-    std::cout << "init boundary" << std::endl;
-    for (uint i = 0; i < bnd.size(); i++) {
-        bnd_uv.row(i) = TC.row(bnd[i]);
+    {
+        TRACE_SCOPE("load");
+        igl::readOBJ(file, V, TC, N, F, FTC, FN);
     }
-
-    igl::harmonic(V,F,bnd,bnd_uv,1,uv_init);
-    if (igl::flipped_triangles(uv_init,F).size() != 0) {
-        igl::harmonic(F,bnd,bnd_uv,1,uv_init); // use uniform laplacian
+    trace::counter("vertices", V.rows());
+    trace::counter("faces", F.rows());
+
+    // the other frames of an animation, read ahead while this one is solved
+    std::vector<std::string> frames;
+    std::unique_ptr<FrameReader> frame_reader;
+    if (opts.has("sequence")) {
+        if (!read_frame_list(opts.get("sequence", ""), frames)) {
+            std::cerr << "Error! Cannot read the frame list " << opts.get("sequence", "") << std::endl;
+            return 1;
+        }
+        frame_reader.reset(new FrameReader(frames, F,
+            [](const std::string &path, Eigen::MatrixXd &V_frame, Eigen::MatrixXi &F_frame) {
+                return igl::readOBJ(path, V_frame, F_frame);
+            }));
     }
 
-    cout << "initialized parametrization" << endl;
-    double soft_const_p = 1e35;
-    sData.slim_energy = igl::MappingEnergyType::SYMMETRIC_DIRICHLET;
-    slim_precompute(V, F, uv_init, sData, igl::MappingEnergyType::SYMMETRIC_DIRICHLET, bnd, bnd_uv, soft_const_p);
-    cout << "energy = " << sData.energy << endl;
-    slim_solve(sData, 100); // 10 iter
-
-    cout << "energy = " << sData.energy << endl;
-
-    Eigen::MatrixXd empty(0, 3);
-    const std::string out_file = file.substr(0, file.size()-4) + "_slim.obj";
-    std::cout << out_file << std::endl;
-    writeOBJ(out_file, V, F, sData.V_o, F);
-
-    return 0;
-}
+    // the boundary keeps the input uv
+    Eigen::MatrixXd uv = Eigen::MatrixXd::Zero(V.rows(), 2);
+    if (TC.rows() > 0 && FTC.rows() == F.rows()) uv = uv_per_vertex(V.rows(), F, TC, FTC);
 
-void check_mesh_for_issues(Eigen::MatrixXd& V, Eigen::MatrixXi& F) {
-
-    Eigen::SparseMatrix<double> A;
-    igl::adjacency_matrix(F,A);
+    if (opts.has("previous")) {
+        // re-solve only around the edit, see incremental.hpp; without input
+        // uvs the boundary keeps the previous ones
+        Eigen::MatrixXd V_prev, TC_prev, N_prev;
+        Eigen::MatrixXi F_prev, FTC_prev, FN_prev;
+        {
+            TRACE_SCOPE("load_previous");
+            igl::readOBJ(opts.get("previous", ""), V_prev, TC_prev, N_prev, F_prev, FTC_prev, FN_prev);
+        }
+        if (TC_prev.rows() == 0 || FTC_prev.rows() != F_prev.rows()) {
+            std::cerr << "Error! Previous result has no texture coordinates" << std::endl;
+            return 1;
+        }
 
-    Eigen::MatrixXi C, Ci;
-    igl::vertex_components(A, C, Ci);
+        options.use_input = TC.rows() > 0;
+        if (!parametrization::slim_incremental(V, F, V_prev, F_prev, uv_per_vertex(V_prev.rows(), F_prev, TC_prev, FTC_prev),
+                                               uv, options, opts.get_int("rings", 2))) {
+            return 1;
+        }
 
-    int connected_components = Ci.rows();
-    if (connected_components!=1) {
-        cout << "Error! Input has multiple connected components" << endl; exit(1);
-    }
-    int euler_char = igl::euler_characteristic(V, F);
-    if (euler_char!=1)
-    {
-        cout <<
-            "Error! Input does not have a disk topology, it's euler char is " <<
-            euler_char << endl;
-        exit(1);
-    }
-    bool is_edge_manifold = igl::is_edge_manifold(F);
-    if (!is_edge_manifold) {
-        cout << "Error! Input is not an edge manifold" << endl; exit(1);
+        std::cout << out_file << std::endl;
+        {
+            TRACE_SCOPE("export");
+            if (!writeOBJ(out_file, V, F, uv, F)) {
+                return 1;
+            }
+        }
+        if (opts.has("binary-bits") && !write_binary_output(out_file, opts.get_int("binary-bits", 16), V, F, uv, F)) {
+            return 1;
+        }
+        return 0;
     }
 
-    Eigen::VectorXd areas; igl::doublearea(V,F,areas);
-    const double eps = 1e-14;
-    for (int i = 0; i < areas.rows(); i++) {
-        if (areas(i) < eps) {
-            cout << "Error! Input has zero area faces" << endl; exit(1);
-        }
+    if (TC.rows() == 0) {
+        std::cerr << "Error! Input has no texture coordinates for the boundary" << std::endl;
+        return 1;
     }
-}
 
+    parametrization::SlimResult result;
+    if (!parametrization::slim(V, F, uv, options, result)) {
+        return 1;
+    }
 
-void writeOBJ(const std::string str,
-    const Eigen::MatrixXd& V,
-    const Eigen::MatrixXi& F,
-    const Eigen::MatrixXd& TC,
-    const Eigen::MatrixXi& FTC)
-{
-    FILE * obj_file = fopen(str.c_str(),"w");
-    if(NULL==obj_file)
-    {
-        printf("IOError: %s could not be opened for writing...",str.c_str());
-        return;
+    if (opts.has("distortion")) {
+        TRACE_SCOPE("distortion");
+        print_distortion(stdout, compute_distortion(V, F, uv));
     }
-    // Loop over V
-    for(int i = 0;i<(int)V.rows();i++)
+
+    std::cout << out_file << std::endl;
     {
-        fprintf(obj_file,"v");
-        for(int j = 0;j<(int)V.cols();++j)
-        {
-            fprintf(obj_file," %0.17g", V(i,j));
+        TRACE_SCOPE("export");
+        if (!writeOBJ(out_file, V, F, uv, F)) {
+            return 1;
         }
-        fprintf(obj_file,"\n");
     }
-    bool write_N = false;
-
-
-    bool write_texture_coords = TC.rows() >0;
+    if (opts.has("binary-bits") && !write_binary_output(out_file, opts.get_int("binary-bits", 16), V, F, uv, F)) {
+        return 1;
+    }
 
-    if(write_texture_coords)
-    {
-        for(int i = 0;i<(int)TC.rows();i++)
-        {
-            fprintf(obj_file, "vt %0.17g %0.17g\n",TC(i,0),TC(i,1));
+    // partial runs keep their checkpoint so they can be resumed; the report
+    // is written once the sequence is done
+    RunReport report;
+    report.tool = "slim_bnd";
+    report.output = out_file;
+    report.iterations = result.iterations - result.first_iteration;
+    report.requested_iterations = options.iterations - result.first_iteration;
+    report.energy = result.energy;
+    report.flips = result.flips;
+    const std::string report_file = out_file.substr(0, out_file.size()-4) + ".report.json";
+    if (run_budget().stopped()) {
+        if (frame_reader) {
+            report.frames = 0;
+            report.requested_frames = frames.size();
         }
-        fprintf(obj_file,"\n");
+        report.write(report_file);
+        std::cerr << "Warning: partial result written to " << out_file << std::endl;
+        return 0;
     }
-
-    // loop over F
-    for(int i = 0;i<(int)F.rows();++i)
-    {
-        fprintf(obj_file,"f");
-        for(int j = 0; j<(int)F.cols();++j)
-        {
-          // OBJ is 1-indexed
-          fprintf(obj_file," %u",F(i,j)+1);
-
-          if(write_texture_coords)
-            fprintf(obj_file,"/%u",FTC(i,j)+1);
-
+    remove_slim_checkpoint(options.checkpoint);
+
+    if (frame_reader) {
+        // warm start every frame from the previous one, reusing the solver
+        auto next = [&frame_reader](Eigen::MatrixXd &V_frame) {
+            std::string frame;
+            return frame_reader->next(frame, V_frame) && V_frame.rows() > 0;
+        };
+        auto write = [&frames, &F, &opts](int frame, const Eigen::MatrixXd &V_frame, const Eigen::MatrixXd &uv_frame) {
+            const std::string &path = frames[frame];
+            const std::string frame_file = path.substr(0, path.size()-4) + "_slim.obj";
+            if (!writeOBJ(frame_file, V_frame, F, uv_frame, F)) return false;
+            return !opts.has("binary-bits") ||
+                   write_binary_output(frame_file, opts.get_int("binary-bits", 16), V_frame, F, uv_frame, F);
+        };
+        int solved = parametrization::slim_sequence(V, F, uv, options, opts.get_int("frame-iterations", 10), next, write);
+        std::cout << solved << " / " << frames.size() << " frames" << std::endl;
+        report.frames = solved;
+        report.requested_frames = frames.size();
+        report.write(report_file);
+        if (solved < (int)frames.size()) {
+            if (run_budget().stopped()) {
+                std::cerr << "Warning: sequence stopped after " << solved << " frames" << std::endl;
+                return 0;
+            }
+            return 1;
         }
-        fprintf(obj_file,"\n");
+        return 0;
     }
-    fclose(obj_file);
 
+    report.write(report_file);
+    return 0;
 }
-
-
@@ -1,163 +1,145 @@
-
-#include <CGAL/Simple_cartesian.h>
-#include <CGAL/Surface_mesh.h>
-#include <CGAL/Polyhedron_3.h>
-#include <CGAL/Surface_mesh_parameterization/IO/File_off.h>
-#include <CGAL/Surface_mesh_parameterization/Square_border_parameterizer_3.h>
-#include <CGAL/Surface_mesh_parameterization/Barycentric_mapping_parameterizer_3.h>
-#include <CGAL/Surface_mesh_parameterization/Error_code.h>
-#include <CGAL/Surface_mesh_parameterization/parameterize.h>
-#include <CGAL/Polygon_mesh_processing/measure.h>
-
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
-#include <sstream>
-
-typedef CGAL::Simple_cartesian<double>       Kernel;
-typedef Kernel::Point_2                      Point_2;
-typedef Kernel::Point_3                      Point_3;
-
-typedef CGAL::Surface_mesh<Kernel::Point_3>  SurfaceMesh;
-typedef CGAL::Polyhedron_3<Kernel>           PolyMesh;
-
-typedef boost::graph_traits<SurfaceMesh>::halfedge_descriptor halfedge_descriptor;
-typedef boost::graph_traits<SurfaceMesh>::vertex_descriptor   vertex_descriptor;
-typedef boost::graph_traits<SurfaceMesh>::face_descriptor     face_descriptor;
+#include <memory>
+#include <vector>
 
-typedef SurfaceMesh::Property_map<vertex_descriptor, Point_2>  UV_pmap;
-typedef boost::unordered_map<vertex_descriptor, std::size_t> Vertex_index_map;
+#include "atomic_output.hpp"
+#include "off_input.hpp"
+#include "options.hpp"
+#include "parametrization.hpp"
+#include "puv_output.hpp"
+#include "sequence.hpp"
+#include "result_cache.hpp"
+#include "trace_alloc.hpp"
 
-namespace SMP = CGAL::Surface_mesh_parameterization;
-
-typedef SMP::Square_border_uniform_parameterizer_3<SurfaceMesh>  Border_parameterizer;
-typedef SMP::Barycentric_mapping_parameterizer_3<SurfaceMesh, Border_parameterizer> Parameterizer;
-
-struct Compute_area:
-  public std::unary_function<const PolyMesh::Facet, double>
-{
-  double operator()(const PolyMesh::Facet& f) const{
-    return Kernel::Compute_area_3()(
-      f.halfedge()->vertex()->point(),
-      f.halfedge()->next()->vertex()->point(),
-      f.halfedge()->opposite()->vertex()->point() );
-  }
-};
-
-void write_obj(std::ofstream &out, SurfaceMesh & sm, UV_pmap uv_map);
-void check_facets_area(SurfaceMesh &mesh, UV_pmap &uv_pm, halfedge_descriptor &bhd);
+bool write_obj(const std::string &path, const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, const Eigen::MatrixXd &uv);
 
 int main(int argc, char** argv)
 {
-    if (argc < 2) {
+    Options opts(argc, argv, {"reorder", "sequence", "binary-bits"});
+    if (!opts.check("Usage: tutte mesh.off [corner0 corner1 corner2 corner3] [--reorder rcm|morton] [--sequence frames.txt]\n"
+                    "       [--binary-bits N]")) {
+        return 1;
+    }
+    if (opts.size() < 1) {
         std::cout << "ERROR! File name missing." << std::endl;
         return 1;
     }
-    
-    std::string file(argv[1]);
-    std::ifstream in(argv[1]);
-    if(!in) {
-        std::cerr << "Problem loading the input data" << std::endl;
-        return EXIT_FAILURE;
+
+    std::string file(opts[0]);
+    const bool has_corners = opts.size() > 4;
+    TRACE_SCOPE("tutte");
+    std::string out_file = file.substr(0, file.size()-4) + "_tutte.obj";
+
+    // corner vertices and the reordering are part of the cache key
+    std::string params;
+    for (int i = 1; has_corners && i < 5; i++) params += opts[i] + " ";
+    params += "reorder=" + opts.get("reorder", "");
+    ResultCache cache("tutte", params);
+    cache.add_file(file);
+    if (!opts.has("sequence") && !opts.has("binary-bits") && cache.fetch(out_file)) return EXIT_SUCCESS;
+
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    {
+        TRACE_SCOPE("load");
+        if (!read_off(file, V, F)) {
+            std::cerr << "Problem loading the input data" << std::endl;
+            return EXIT_FAILURE;
+        }
     }
-    
-    // read mesh
-    SurfaceMesh sm;
-    in >> sm;
-    
-    // A halfedge on the border
-    halfedge_descriptor bhd = CGAL::Polygon_mesh_processing::longest_border(sm).first;
-    
-    // The 2D points of the uv parametrisation will be written into this map
-    UV_pmap uv_map = sm.add_property_map<vertex_descriptor, Point_2>("v:uv").first;
-    
-    Parameterizer param;
-    if (argc > 3) {
-        vertex_descriptor v1(atoi(argv[2]));
-        vertex_descriptor v2(atoi(argv[3]));
-        vertex_descriptor v3(atoi(argv[4]));
-        vertex_descriptor v4(atoi(argv[5]));
-        Border_parameterizer border_param = Border_parameterizer(v1, v2, v3, v4);
-        param = Parameterizer(border_param); // set corner constrain here
-    } else {
-        param = Parameterizer();
+    trace::counter("vertices", V.rows());
+    trace::counter("faces", F.rows());
+
+    // the other frames of an animation, read ahead while this one is solved.
+    // Barycentric weights and a uniform border only depend on the
+    // connectivity, so the parametrization is computed once for all frames.
+    std::vector<std::string> frames;
+    std::unique_ptr<FrameReader> frame_reader;
+    if (opts.has("sequence")) {
+        if (!read_frame_list(opts.get("sequence", ""), frames)) {
+            std::cerr << "Problem loading the frame list " << opts.get("sequence", "") << std::endl;
+            return EXIT_FAILURE;
+        }
+        frame_reader.reset(new FrameReader(frames, F, read_off));
     }
-    
-    // Parametrization
-    //Parameterizer param = Parameterizer(); // set corner constrain here
-    SMP::Error_code err = SMP::parameterize(sm, param, bhd, uv_map);
-    
-    // check parametrization is OK
-    if(err != SMP::OK) {
-        std::cerr << "Error: " << SMP::get_error_message(err) << std::endl;
+
+    // corners and the output refer to the input vertices, also with --reorder
+    int corner_vertices[4];
+    for (int i = 0; has_corners && i < 4; i++) corner_vertices[i] = atoi(opts[i + 1].c_str());
+    Eigen::MatrixXd uv(V.rows(), 2);
+    int null_faces = 0;
+    if (!parametrization::tutte(V, F, uv, has_corners ? corner_vertices : nullptr, opts.get("reorder", ""), &null_faces)) {
         return EXIT_FAILURE;
     }
-    
+
     // save file
-    std::string out_file = file.substr(0, file.size()-4) + "_tutte.obj";
-    std::ofstream out(out_file);
-    write_obj(out, sm, uv_map);
-    
-    check_facets_area(sm, uv_map, bhd);
+    {
+        TRACE_SCOPE("export");
+        if (!write_obj(out_file, V, F, uv)) return EXIT_FAILURE;
+    }
+    cache.store(out_file);
+    if (opts.has("binary-bits")) {
+        TRACE_SCOPE("export_binary");
+        if (!write_binary_output(out_file, opts.get_int("binary-bits", 16), V, F, uv, F)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (null_faces > 0) {
+        std::cerr << "WARNING: " << null_faces << " faces have 0 area!" << std::endl;
+    }
+
+    if (frame_reader) {
+        TRACE_SCOPE("sequence");
+        std::string frame;
+        Eigen::MatrixXd V_frame;
+        int written = 0;
+        while (frame_reader->next(frame, V_frame)) {
+            if (V_frame.rows() == 0) return EXIT_FAILURE;
+            const std::string frame_file = frame.substr(0, frame.size()-4) + "_tutte.obj";
+            if (!write_obj(frame_file, V_frame, F, uv)) return EXIT_FAILURE;
+            if (opts.has("binary-bits") &&
+                !write_binary_output(frame_file, opts.get_int("binary-bits", 16), V_frame, F, uv, F)) {
+                return EXIT_FAILURE;
+            }
+            written++;
+        }
+        trace::counter("frames", written);
+        std::cout << written << " / " << frames.size() << " frames" << std::endl;
+    }
 
     return EXIT_SUCCESS;
 
 }
 
-void write_obj(std::ofstream &out, SurfaceMesh & sm, UV_pmap uv_map)  
+// one texture coordinate per vertex, in [-1, 1]^2
+bool write_obj(const std::string &path, const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, const Eigen::MatrixXd &uv)
 {
-    std::size_t vertices_counter = 0;
-    
-    Vertex_index_map vium;
-    boost::associative_property_map<Vertex_index_map> vimap(vium);
-    
+    AtomicOutput output(path);
+    std::ofstream out(output.temp_path());
+
     // vertices
-    for(auto vd : sm.vertices()){
-        out << "v " << sm.point(vd) << std::endl;
+    for (int i = 0; i < V.rows(); i++) {
+        out << "v " << V(i, 0) << " " << V(i, 1) << " " << V(i, 2) << '\n';
     }
-    
+
     // texture coordinates
-    SurfaceMesh::Vertex_range::iterator  vb, ve;
-    for(boost::tie(vb, ve) = sm.vertices(); vb != ve; ++vb){
-        auto uv = get(uv_map, *vb);
-        out << "vt " << (uv.x()*2.0 -1.0) << " " << (uv.y()*2.0 -1.0) << std::endl;
-        
-        // set vertex index 
-        put(vimap, *vb, vertices_counter++);
+    for (int i = 0; i < uv.rows(); i++) {
+        out << "vt " << uv(i, 0) << " " << uv(i, 1) << '\n';
     }
-    
+
     // faces
-    BOOST_FOREACH(face_descriptor fd, faces(sm)) {
-        halfedge_descriptor hd = halfedge(fd, sm);
+    for (int f = 0; f < F.rows(); f++) {
         out << "f";
-        BOOST_FOREACH(vertex_descriptor vd, vertices_around_face(hd, sm)) {
-            std::size_t idx = get(vimap, vd) + 1;
+        for (int k = 0; k < 3; k++) {
+            int idx = F(f, k) + 1;
             out << " " << idx << "/" << idx << "/" << idx;
         }
-        out << std::endl;
-    }
-
-}
-
-void check_facets_area(SurfaceMesh &mesh, UV_pmap &uv_pm, halfedge_descriptor &bhd)
-{
-    std::stringstream out;
-    SMP::IO::output_uvmap_to_off(mesh, bhd, uv_pm, out);
-
-    PolyMesh tmp;
-    out >> tmp;
-    
-    Compute_area ca;
-    std::size_t num_null_faces = 0;
-
-    for (auto it = tmp.facets_begin(); it != tmp.facets_end(); it++) {
-        if (ca(*it) == 0.0) {
-            num_null_faces++;
-        }
-    }
-    
-    if (num_null_faces > 0) {
-        std::cerr << "WARNING: " << num_null_faces << " faces have 0 area!" << std::endl;
+        out << '\n';
     }
 
+    out.close();
+    return output.commit(!out.fail());
 }
@@ -0,0 +1,64 @@
+#include <iostream>
+
+#include <igl/readOBJ.h>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "options.hpp"
+#include "trace_alloc.hpp"
+#include "uv_overlap.hpp"
+
+using namespace std;
+
+
+int main(int argc, char *argv[])
+{
+    const std::string usage = "Usage: uv_overlap mesh_uv.obj [--faces overlapping_faces.txt]";
+    Options opts(argc, argv, {"faces"});
+    if (!opts.check(usage)) return 1;
+    if (opts.size() < 1) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    std::string file(opts[0]);
+    TRACE_SCOPE("uv_overlap");
+
+    Eigen::MatrixXd V, TC, N;
+    Eigen::MatrixXi F, FTC, FN;
+    {
+        TRACE_SCOPE("load");
+        if (!igl::readOBJ(file, V, TC, N, F, FTC, FN)) {
+            std::cerr << "Problem loading the input data" << std::endl;
+            return 1;
+        }
+    }
+    trace::counter("vertices", V.rows());
+    trace::counter("faces", F.rows());
+
+    if (TC.rows() == 0) {
+        std::cerr << "ERROR! " << file << " has no texture coordinates." << std::endl;
+        return 1;
+    }
+    if (FTC.rows() != F.rows()) FTC = F;
+
+    OverlapResult result = find_uv_overlaps(TC, FTC);
+    printf("overlapping pairs: %lld\n", result.pairs);
+    printf("overlapping faces: %d / %d\n", (int)result.faces.size(), (int)F.rows());
+
+    if (opts.has("faces")) {
+        TRACE_SCOPE("export");
+        std::string out_file = opts.get("faces", "");
+        if (out_file.empty()) out_file = file.substr(0, file.size()-4) + "_overlap.txt";
+        FILE *out = fopen(out_file.c_str(), "w");
+        if (out == NULL) {
+            std::cerr << "Cannot write " << out_file << std::endl;
+            return 1;
+        }
+        for (int f : result.faces) fprintf(out, "%d\n", f);
+        fclose(out);
+    }
+
+    return result.pairs > 0 ? 2 : 0;
+}
@@ -0,0 +1,598 @@
+#include "parametrization.hpp"
+
+#include <CGAL/Simple_cartesian.h>
+#include <CGAL/Polyhedron_3.h>
+#include <CGAL/Polyhedron_incremental_builder_3.h>
+#include <CGAL/Polyhedron_items_with_id_3.h>
+#include <CGAL/Surface_mesh.h>
+#include <CGAL/Unique_hash_map.h>
+#include <CGAL/boost/graph/Seam_mesh.h>
+#include <CGAL/boost/graph/dijkstra_shortest_paths.h>
+#include <CGAL/Surface_mesh_parameterization/Square_border_parameterizer_3.h>
+#include <CGAL/Surface_mesh_parameterization/Barycentric_mapping_parameterizer_3.h>
+#include <CGAL/Surface_mesh_parameterization/Error_code.h>
+#include <CGAL/Surface_mesh_parameterization/parameterize.h>
+#include <CGAL/Surface_mesh_shortest_path.h>
+#include <CGAL/Polygon_mesh_processing/measure.h>
+
+#include <boost/property_map/property_map.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "arap.hpp"
+#include "cgal_arrays.hpp"
+#include "distortion.hpp"
+#include "mesh_arena.hpp"
+#include "mesh_operators.hpp"
+#include "mesh_validation.hpp"
+#include "reorder.hpp"
+#include "trace.hpp"
+
+typedef CGAL::Simple_cartesian<double>       Kernel;
+typedef Kernel::Point_2                      Point_2;
+typedef Kernel::Point_3                      Point_3;
+typedef CGAL::Surface_mesh<Point_3>          SurfaceMesh;
+
+typedef boost::graph_traits<SurfaceMesh>::halfedge_descriptor SM_halfedge_descriptor;
+typedef boost::graph_traits<SurfaceMesh>::edge_descriptor     SM_edge_descriptor;
+typedef boost::graph_traits<SurfaceMesh>::vertex_descriptor   SM_vertex_descriptor;
+typedef boost::graph_traits<SurfaceMesh>::face_descriptor     SM_face_descriptor;
+
+typedef SurfaceMesh::Property_map<SM_vertex_descriptor, Point_2> UV_pmap;
+
+// the mesh cut into charts: nodes are bump allocated, see mesh_arena.hpp,
+// and vertex ids are the input rows
+typedef CGAL::Polyhedron_3<Kernel, CGAL::Polyhedron_items_with_id_3, CGAL::HalfedgeDS_default, ArenaAllocator<int> > PolyMesh;
+
+typedef boost::graph_traits<PolyMesh>::halfedge_descriptor PM_halfedge_descriptor;
+typedef boost::graph_traits<PolyMesh>::edge_descriptor     PM_edge_descriptor;
+typedef boost::graph_traits<PolyMesh>::vertex_descriptor   PM_vertex_descriptor;
+
+// seam and uv maps of one chart, outside of the mesh: charts are cut in
+// parallel from the same mesh
+typedef CGAL::Unique_hash_map<PM_edge_descriptor, bool>        Seam_edge_uhm;
+typedef CGAL::Unique_hash_map<PM_vertex_descriptor, bool>      Seam_vertex_uhm;
+typedef CGAL::Unique_hash_map<PM_halfedge_descriptor, Point_2> Seam_UV_uhm;
+typedef boost::associative_property_map<Seam_edge_uhm>   Seam_edge_pmap;
+typedef boost::associative_property_map<Seam_vertex_uhm> Seam_vertex_pmap;
+typedef boost::associative_property_map<Seam_UV_uhm>     Seam_UV_pmap;
+
+typedef CGAL::Seam_mesh<PolyMesh, Seam_edge_pmap, Seam_vertex_pmap> SeamMesh;
+typedef boost::graph_traits<SeamMesh>::vertex_descriptor   vertex_descriptor;
+typedef boost::graph_traits<SeamMesh>::halfedge_descriptor halfedge_descriptor;
+typedef boost::graph_traits<SeamMesh>::face_descriptor     face_descriptor;
+
+typedef CGAL::Surface_mesh_shortest_path_traits<Kernel, SurfaceMesh> Shortest_path_traits;
+typedef CGAL::Surface_mesh_shortest_path<Shortest_path_traits>       Surface_mesh_shortest_path;
+typedef Shortest_path_traits::Barycentric_coordinates                BaryCoord;
+
+namespace SMP = CGAL::Surface_mesh_parameterization;
+namespace PMP = CGAL::Polygon_mesh_processing;
+
+
+namespace parametrization {
+
+namespace {
+
+bool check_uv(const ConstPoints &V, const Points &uv)
+{
+    if (uv.rows() != V.rows() || uv.cols() != 2) {
+        std::cerr << "Error! uv must be " << V.rows() << " x 2, not " << uv.rows() << " x " << uv.cols() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// mesh in the order of `reorder`, the input order if it is empty; the
+// reordered faces go to `reordered_faces` if given
+bool reordered_mesh(const ConstPoints &V, const ConstIndices &F, const std::string &reorder,
+                    SurfaceMesh &mesh, Reordering &reordering, Eigen::MatrixXi *reordered_faces = nullptr)
+{
+    if (reorder.empty()) {
+        arrays_to_mesh(V, F, mesh);
+        return true;
+    }
+    Eigen::MatrixXd Vs = V;
+    Eigen::MatrixXi Fs = F;
+    if (!reordering.compute(reorder, Vs, Fs)) {
+        std::cerr << "Unknown reordering " << reorder << ", use rcm or morton" << std::endl;
+        return false;
+    }
+    reordering.apply(Vs, Fs);
+    arrays_to_mesh(Vs, Fs, mesh);
+    if (reordered_faces != nullptr) reordered_faces->swap(Fs);
+    return true;
+}
+
+// the input-order rule of PMP::longest_border on a mesh built in a reordered
+// order: the longest border loop, on ties the first one, starting at its
+// first halfedge, where border halfedges come in the order of the faces and
+// corners of the input that create them. The map then does not depend on the
+// reordering, and the mesh is built once.
+SM_halfedge_descriptor input_order_longest_border(const SurfaceMesh &sm, const Eigen::MatrixXi &Fs,
+                                                  const Reordering &reordering)
+{
+    // the face and corner of the input that precede border halfedge h
+    auto rank = [&](SM_halfedge_descriptor h) {
+        const SM_halfedge_descriptor inner = opposite(h, sm);
+        const int f = face(inner, sm).idx();
+        int corner = 0;
+        while (corner < 2 && Fs(f, corner) != (int)source(inner, sm).idx()) corner++;
+        return 3 * (long long)reordering.old_face(f) + corner;
+    };
+    std::vector<bool> visited(sm.number_of_halfedges(), false);
+    SM_halfedge_descriptor result;
+    long long result_rank = -1;
+    double result_length = 0.0;
+    for (SM_halfedge_descriptor h : halfedges(sm)) {
+        if (!is_border(h, sm) || visited[h.idx()]) continue;
+        SM_halfedge_descriptor first = h;
+        long long first_rank = rank(h);
+        for (SM_halfedge_descriptor loop : halfedges_around_face(h, sm)) {
+            visited[loop.idx()] = true;
+            const long long loop_rank = rank(loop);
+            if (loop_rank < first_rank) {
+                first = loop;
+                first_rank = loop_rank;
+            }
+        }
+        // summed from the first halfedge on, like longest_border does
+        double length = 0.0;
+        for (SM_halfedge_descriptor loop : halfedges_around_face(first, sm)) length += PMP::edge_length(loop, sm);
+        if (result_rank < 0 || length > result_length || (length == result_length && first_rank < result_rank)) {
+            result = first;
+            result_rank = first_rank;
+            result_length = length;
+        }
+    }
+    return result;
+}
+
+template <class HDS>
+class ArraysBuilder : public CGAL::Modifier_base<HDS> {
+public:
+    ArraysBuilder(const ConstPoints &V, const ConstIndices &F) : V(V), F(F) {}
+
+    void operator()(HDS &hds)
+    {
+        typedef typename HDS::Vertex::Point Point;
+        CGAL::Polyhedron_incremental_builder_3<HDS> builder(hds, true);
+        builder.begin_surface(V.rows(), F.rows(), 2 * (V.rows() + F.rows()));
+        for (int v = 0; v < V.rows(); v++) builder.add_vertex(Point(V(v, 0), V(v, 1), V(v, 2)));
+        for (int f = 0; f < F.rows(); f++) {
+            builder.begin_facet();
+            for (int k = 0; k < 3; k++) builder.add_vertex_to_facet(F(f, k));
+            builder.end_facet();
+        }
+        builder.end_surface();
+    }
+
+private:
+    const ConstPoints &V;
+    const ConstIndices &F;
+};
+
+// builds the polyhedron of V, F in `arena`, reserved for its counts; vertex
+// i has id i and is handles[i]. The polyhedron is never destroyed: its
+// nodes go with the arena, chunk by chunk, instead of one by one.
+PolyMesh *arena_polyhedron(const ConstPoints &V, const ConstIndices &F, MeshArena &arena,
+                           std::vector<PM_vertex_descriptor> &handles)
+{
+    TRACE_SCOPE("build");
+    ArenaScope scope(arena);
+    reserve_polyhedron<PolyMesh>(V.rows(), F.rows());
+    PolyMesh *sm = arena.create<PolyMesh>();
+    ArraysBuilder<PolyMesh::HalfedgeDS> builder(V, F);
+    sm->delegate(builder);
+    if (sm->size_of_vertices() != (std::size_t)V.rows() || sm->size_of_facets() != (std::size_t)F.rows()) {
+        std::cerr << "Error! The mesh could not be built, your model might not be manifold." << std::endl;
+        return nullptr;
+    }
+    CGAL::set_halfedgeds_items_id(*sm);
+    handles.clear();
+    handles.reserve(V.rows());
+    for (PM_vertex_descriptor v : vertices(*sm)) handles.push_back(v);
+    trace::counter("arena_chunks", arena.num_chunks());
+    return sm;
+}
+
+// cuts sm along the seams, maps it like tutte, optionally refines the map
+// with ARAP and measures the result. Messages are written to `messages`,
+// since charts are cut in parallel; name prefixes them.
+bool cut_chart(const PolyMesh &sm, const std::vector<PM_vertex_descriptor> &handles, const ConstIndices &seams,
+               const CutOptions &options, const std::string &name, Chart &chart, std::ostream &messages)
+{
+    typedef SMP::Square_border_uniform_parameterizer_3<SeamMesh> Border_parameterizer;
+    typedef SMP::Barycentric_mapping_parameterizer_3<SeamMesh, Border_parameterizer> Parameterizer;
+    TRACE_SCOPE("candidate");
+
+    Seam_edge_uhm seam_edges(false);
+    Seam_vertex_uhm seam_vertices(false);
+    Seam_edge_pmap seam_edge_pm(seam_edges);
+    Seam_vertex_pmap seam_vertex_pm(seam_vertices);
+    SeamMesh mesh(sm, seam_edge_pm, seam_vertex_pm);
+
+    const int nv = handles.size();
+    int num_seams = 0;
+    for (int i = 0; i < seams.rows(); i++) {
+        const int s = seams(i, 0), t = seams(i, 1);
+        if (s < 0 || s >= nv || t < 0 || t >= nv) {
+            messages << "Error! " << name << "Seam vertex " << (s < 0 || s >= nv ? s : t) << " is not a vertex" << std::endl;
+            return false;
+        }
+        std::pair<PM_edge_descriptor, bool> e = edge(handles[s], handles[t], sm);
+        if (!e.second) {
+            messages << "Warning: " << name << "Ignored seam " << s << " " << t << ", not an edge of the mesh" << std::endl;
+            continue;
+        }
+        // already open
+        if (is_border(e.first, sm) || get(seam_edge_pm, e.first)) continue;
+        mesh.add_seam(handles[s], handles[t]);
+        num_seams++;
+    }
+    if (num_seams == 0) {
+        messages << "Warning: " << name << "No seams in input" << std::endl;
+    }
+
+    // A halfedge on the (possibly virtual) border
+    halfedge_descriptor bhd = PMP::longest_border(mesh, PMP::parameters::all_default()).first;
+    Seam_UV_uhm uv_map(Point_2(), sm.size_of_halfedges());
+    Seam_UV_pmap uv_pm(uv_map);
+
+    Parameterizer param;
+    SMP::Error_code err = SMP::parameterize(mesh, param, bhd, uv_pm);
+    if (err != SMP::OK) {
+        messages << "Error! " << name << SMP::get_error_message(err) << std::endl;
+        return false;
+    }
+
+    // chart vertices in the order of the seam mesh
+    boost::unordered_map<vertex_descriptor, int> index;
+    index.reserve(num_vertices(mesh));
+    Eigen::MatrixXd uv(num_vertices(mesh), 2);
+    chart.V.resize(num_vertices(mesh), 3);
+    chart.vertex.resize(num_vertices(mesh));
+    int nc = 0;
+    for (vertex_descriptor vd : vertices(mesh)) {
+        halfedge_descriptor hd = halfedge(vd, mesh);
+        const PM_vertex_descriptor v = target(hd.tmhd, sm);
+        const Point_3 &p = v->point();
+        const Point_2 &t = get(uv_pm, hd);
+        chart.vertex(nc) = v->id();
+        chart.V.row(nc) << p.x(), p.y(), p.z();
+        uv.row(nc) << t.x(), t.y();
+        index[vd] = nc++;
+    }
+    chart.F.resize(num_faces(mesh), 3);
+    int nf = 0;
+    for (face_descriptor fd : faces(mesh)) {
+        int corner = 0;
+        for (vertex_descriptor vd : vertices_around_face(halfedge(fd, mesh), mesh)) {
+            if (corner < 3) chart.F(nf, corner) = index[vd];
+            corner++;
+        }
+        nf++;
+    }
+    const Eigen::MatrixXd &V = chart.V;
+    const Eigen::MatrixXi &F = chart.F;
+
+    if (options.arap) {
+        MeshOperators ops(V, F);
+        ArapResult result = arap_parametrize(ops, F, uv, options.arap_iterations, options.arap_tolerance);
+        messages << name << "ARAP " << result.iterations << " iterations, energy " << result.energy
+                 << (result.converged ? "" : " (not converged)") << std::endl;
+
+        // back into the unit square, keeping the aspect ratio, like the Tutte map
+        Eigen::RowVector2d lo = uv.colwise().minCoeff();
+        double extent = (uv.colwise().maxCoeff() - lo).maxCoeff();
+        uv = (uv.rowwise() - lo) / extent;
+    }
+
+    // distortion of the chart scaled to the surface area, so the dirichlet
+    // energies of charts cut differently compare
+    double area_3d = 0.0, area_uv = 0.0;
+    chart.null_faces = 0;
+    for (int f = 0; f < F.rows(); f++) {
+        Eigen::Vector3d a = V.row(F(f, 0)), b = V.row(F(f, 1)), c = V.row(F(f, 2));
+        Eigen::RowVector2d e1 = uv.row(F(f, 1)) - uv.row(F(f, 0));
+        Eigen::RowVector2d e2 = uv.row(F(f, 2)) - uv.row(F(f, 0));
+        double det = e1.x() * e2.y() - e1.y() * e2.x();
+        area_3d += 0.5 * (b - a).cross(c - a).norm();
+        area_uv += 0.5 * std::abs(det);
+        chart.null_faces += det == 0.0;
+    }
+    const double scale = area_uv > 0.0 ? std::sqrt(area_3d / area_uv) : 1.0;
+    DistortionStats stats = compute_distortion(V, F, uv * scale);
+    chart.flips = stats.flips;
+    chart.degenerate = stats.degenerate;
+    chart.symmetric_dirichlet = stats.symmetric_dirichlet;
+    chart.conformal = stats.conformal_mean;
+    chart.area = stats.area_mean;
+    if (options.arap && stats.flips > 0) {
+        messages << "Warning: " << name << "ARAP flipped " << stats.flips << " faces" << std::endl;
+    }
+
+    // same layout as the tool output
+    chart.uv.resize(uv.rows(), 2);
+    chart.uv.col(0) = (1.0 - 2.0 * uv.col(0).array()).matrix();
+    chart.uv.col(1) = (2.0 * uv.col(1).array() - 1.0).matrix();
+    return F.rows() > 0;
+}
+
+} // namespace
+
+
+bool tutte(const ConstPoints &V, const ConstIndices &F, Points uv, const int *corners,
+           const std::string &reorder, int *null_faces)
+{
+    typedef SMP::Square_border_uniform_parameterizer_3<SurfaceMesh> Border_parameterizer;
+    typedef SMP::Barycentric_mapping_parameterizer_3<SurfaceMesh, Border_parameterizer> Parameterizer;
+    TRACE_SCOPE("tutte");
+
+    MeshRequirements requirements;
+    requirements.disk = true; // the border is mapped to a square
+    if (!check_uv(V, uv) || !check_mesh(V, F, requirements)) return false;
+    for (int i = 0; corners != nullptr && i < 4; i++) {
+        if (corners[i] < 0 || corners[i] >= V.rows()) {
+            std::cerr << "Error! Corner " << corners[i] << " is not a vertex" << std::endl;
+            return false;
+        }
+    }
+
+    // the border start is found by the input order, so the map does not
+    // depend on the reordering
+    SurfaceMesh sm;
+    Reordering reordering;
+    Eigen::MatrixXi Fs;
+    if (!reordered_mesh(V, F, reorder, sm, reordering, &Fs)) return false;
+    SM_halfedge_descriptor bhd;
+    {
+        TRACE_SCOPE("border");
+        bhd = reorder.empty() ? PMP::longest_border(sm).first : input_order_longest_border(sm, Fs, reordering);
+    }
+    UV_pmap uv_map = sm.add_property_map<SM_vertex_descriptor, Point_2>("v:uv").first;
+
+    Parameterizer param;
+    if (corners != nullptr) {
+        param = Parameterizer(Border_parameterizer(SM_vertex_descriptor(reordering.new_vertex(corners[0])),
+                                                   SM_vertex_descriptor(reordering.new_vertex(corners[1])),
+                                                   SM_vertex_descriptor(reordering.new_vertex(corners[2])),
+                                                   SM_vertex_descriptor(reordering.new_vertex(corners[3]))));
+    }
+    SMP::Error_code err;
+    {
+        TRACE_SCOPE("parameterize");
+        err = SMP::parameterize(sm, param, bhd, uv_map);
+    }
+    if (err != SMP::OK) {
+        std::cerr << "Error: " << SMP::get_error_message(err) << std::endl;
+        return false;
+    }
+
+    // same layout as the tool output, in input order
+    for (int i = 0; i < V.rows(); i++) {
+        const Point_2 &p = get(uv_map, SM_vertex_descriptor(reordering.new_vertex(i)));
+        uv(i, 0) = p.x() * 2.0 - 1.0;
+        uv(i, 1) = p.y() * 2.0 - 1.0;
+    }
+    if (null_faces != nullptr) {
+        *null_faces = 0;
+        for (SM_face_descriptor fd : faces(sm)) {
+            SM_halfedge_descriptor hd = halfedge(fd, sm);
+            *null_faces += Kernel::Compute_area_2()(get(uv_map, source(hd, sm)), get(uv_map, target(hd, sm)),
+                                                    get(uv_map, target(next(hd, sm), sm))) == 0.0;
+        }
+    }
+    return true;
+}
+
+
+bool seam_paths(const ConstPoints &V, const ConstIndices &F, const ConstIndices &endpoints, Eigen::MatrixXi &seams,
+                const std::string &reorder)
+{
+    TRACE_SCOPE("seam_paths");
+    // only the edge graph is used: degenerate faces do not matter
+    MeshRequirements requirements;
+    requirements.single_component = false;
+    requirements.non_degenerate = false;
+    if (!check_mesh(V, F, requirements)) return false;
+    if (endpoints.cols() != 2) {
+        std::cerr << "Error! Endpoints must have two columns" << std::endl;
+        return false;
+    }
+    const int nv = V.rows();
+    for (int i = 0; i < endpoints.rows(); i++) {
+        for (int k = 0; k < 2; k++) {
+            if (endpoints(i, k) < 0 || endpoints(i, k) >= nv) {
+                std::cerr << "Error! Endpoint " << endpoints(i, k) << " is not a vertex" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    SurfaceMesh tmesh;
+    Reordering reordering;
+    if (!reordered_mesh(V, F, reorder, tmesh, reordering)) return false;
+    auto vertex_index = get(boost::vertex_index, tmesh);
+
+    // the paths are independent
+    std::vector<std::vector<int>> paths(endpoints.rows());
+    bool connected = true;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < (int)endpoints.rows(); i++) {
+        SM_vertex_descriptor vstart(reordering.new_vertex(endpoints(i, 0))), vend(reordering.new_vertex(endpoints(i, 1)));
+        std::vector<SM_vertex_descriptor> predecessor(nv);
+        std::vector<double> distance(nv);
+        boost::dijkstra_shortest_paths(tmesh, vstart,
+                                       boost::distance_map(boost::make_iterator_property_map(distance.begin(), vertex_index))
+                                       .predecessor_map(boost::make_iterator_property_map(predecessor.begin(), vertex_index))
+                                       .vertex_index_map(vertex_index));
+
+        std::vector<int> &path = paths[i];
+        SM_vertex_descriptor it = vend;
+        path.push_back(reordering.old_vertex(it.idx()));
+        while (it != vstart) {
+            SM_vertex_descriptor next = predecessor[it.idx()];
+            if (next == it) {
+                #pragma omp critical
+                std::cerr << "Error! No path between " << endpoints(i, 0) << " and " << endpoints(i, 1) << std::endl;
+                connected = false;
+                break;
+            }
+            it = next;
+            path.push_back(reordering.old_vertex(it.idx()));
+        }
+    }
+    if (!connected) return false;
+
+    int num_edges = 0;
+    for (const std::vector<int> &path : paths) num_edges += (int)path.size() - 1;
+    seams.resize(num_edges, 2);
+    int e = 0;
+    for (const std::vector<int> &path : paths) {
+        for (std::size_t k = 0; k + 1 < path.size(); k++) seams.row(e++) << path[k], path[k + 1];
+    }
+    return true;
+}
+
+
+bool cut(const ConstPoints &V, const ConstIndices &F, const ConstIndices &seams, Chart &chart, const CutOptions &options)
+{
+    TRACE_SCOPE("cut");
+    // closed inputs are fine, the seams open them
+    MeshRequirements requirements;
+    if (!check_mesh(V, F, requirements)) return false;
+    if (seams.rows() > 0 && seams.cols() != 2) {
+        std::cerr << "Error! Seams must have two columns" << std::endl;
+        return false;
+    }
+
+    MeshArena arena;
+    std::vector<PM_vertex_descriptor> handles;
+    const PolyMesh *sm = arena_polyhedron(V, F, arena, handles);
+    if (sm == nullptr) return false;
+    std::ostringstream messages;
+    bool ok = cut_chart(*sm, handles, seams, options, "", chart, messages);
+    std::cerr << messages.str();
+    return ok;
+}
+
+
+bool cut_candidates(const ConstPoints &V, const ConstIndices &F, const std::vector<Eigen::MatrixXi> &seams,
+                    std::vector<Chart> &charts, std::vector<int> &order, const CutOptions &options)
+{
+    TRACE_SCOPE("cut");
+    const std::string &rank = options.rank;
+    if (rank != "dirichlet" && rank != "conformal" && rank != "area") {
+        std::cerr << "Error! Unknown --rank " << rank << ", expected dirichlet, conformal or area" << std::endl;
+        return false;
+    }
+    MeshRequirements requirements;
+    if (!check_mesh(V, F, requirements)) return false;
+    for (const Eigen::MatrixXi &candidate : seams) {
+        if (candidate.rows() > 0 && candidate.cols() != 2) {
+            std::cerr << "Error! Seams must have two columns" << std::endl;
+            return false;
+        }
+    }
+
+    // the candidates share the mesh read-only, each one cuts it with its own
+    // seam overlay and uv map; messages are printed after the parallel
+    // section, in order
+    MeshArena arena;
+    std::vector<PM_vertex_descriptor> handles;
+    const PolyMesh *sm = arena_polyhedron(V, F, arena, handles);
+    if (sm == nullptr) return false;
+    const int nc = seams.size();
+    charts.assign(nc, Chart());
+    std::vector<char> ok(nc, 0);
+    std::vector<std::string> messages(nc);
+    {
+        TRACE_SCOPE("candidates");
+        trace::counter("candidates", nc);
+        #pragma omp parallel for schedule(dynamic, 1) if (nc > 1)
+        for (int c = 0; c < nc; c++) {
+            std::ostringstream out;
+            ok[c] = cut_chart(*sm, handles, seams[c], options, nc > 1 ? "candidate " + std::to_string(c + 1) + ": " : "",
+                              charts[c], out);
+            messages[c] = out.str();
+        }
+    }
+    for (const std::string &message : messages) std::cerr << message;
+
+    // fewest flipped and degenerate faces first, then lowest distortion
+    auto score = [&rank](const Chart &chart) {
+        if (rank == "conformal") return chart.conformal;
+        if (rank == "area") return chart.area;
+        return chart.symmetric_dirichlet;
+    };
+    order.clear();
+    for (int c = 0; c < nc; c++) {
+        if (ok[c]) order.push_back(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        int invalid_a = charts[a].flips + charts[a].degenerate;
+        int invalid_b = charts[b].flips + charts[b].degenerate;
+        if (invalid_a != invalid_b) return invalid_a < invalid_b;
+        return score(charts[a]) < score(charts[b]);
+    });
+    if (order.empty()) {
+        std::cerr << "Error! No seam file could be parametrized" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool geodesic_distances(const ConstPoints &V, const ConstIndices &F,
+                        const Eigen::Ref<const Eigen::VectorXi> &source_faces, const ConstPoints &source_bary,
+                        const Eigen::Ref<const Eigen::VectorXi> &target_faces, const ConstPoints &target_bary,
+                        Eigen::Ref<Eigen::VectorXd> distances, bool normalize, const std::string &reorder)
+{
+    TRACE_SCOPE("geodesic");
+    // queries may live on different components
+    MeshRequirements requirements;
+    requirements.single_component = false;
+    if (!check_mesh(V, F, requirements)) return false;
+
+    const int nq = source_faces.size();
+    if (target_faces.size() != nq || source_bary.rows() != nq || target_bary.rows() != nq ||
+        source_bary.cols() != 3 || target_bary.cols() != 3 || distances.size() != nq) {
+        std::cerr << "Error! Inconsistent query sizes" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < nq; i++) {
+        if (source_faces(i) < 0 || source_faces(i) >= F.rows() || target_faces(i) < 0 || target_faces(i) >= F.rows()) {
+            std::cerr << "Error! Query " << i << " is not on a face" << std::endl;
+            return false;
+        }
+        if (source_bary.row(i).sum() - 1.0 > 1.0e-4 || target_bary.row(i).sum() - 1.0 > 1.0e-4) {
+            std::cerr << "Error! One of the barycentric coordinates does not sum up to 1." << std::endl;
+            return false;
+        }
+    }
+
+    SurfaceMesh mesh;
+    Reordering reordering;
+    if (!reordered_mesh(V, F, reorder, mesh, reordering)) return false;
+    const double norm_factor = normalize ? std::sqrt(PMP::area(mesh)) : 1.0;
+
+    Surface_mesh_shortest_path shortest_paths(mesh);
+    for (int i = 0; i < nq; i++) {
+        shortest_paths.add_source_point(SM_face_descriptor(reordering.new_face(source_faces(i))),
+                                        BaryCoord({ source_bary(i, 0), source_bary(i, 1), source_bary(i, 2) }));
+        auto result = shortest_paths.shortest_distance_to_source_points(
+            SM_face_descriptor(reordering.new_face(target_faces(i))),
+            BaryCoord({ target_bary(i, 0), target_bary(i, 1), target_bary(i, 2) }));
+        distances(i) = result.first / norm_factor;
+        shortest_paths.remove_all_source_points();
+    }
+    return true;
+}
+
+} // namespace parametrization
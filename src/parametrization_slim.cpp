@@ -0,0 +1,356 @@
+// The SLIM entry points of parametrization.hpp, on arrays only (no CGAL).
+
+#include "parametrization.hpp"
+
+#include <igl/boundary_loop.h>
+#include <igl/flipped_triangles.h>
+#include <igl/map_vertices_to_circle.h>
+#include <igl/slim.h>
+
+#include <iostream>
+
+#include "amg.hpp"
+#include "checkpoint.hpp"
+#include "conformal_init.hpp"
+#include "incremental.hpp"
+#include "mesh_operators.hpp"
+#include "mesh_validation.hpp"
+#include "newton_engine.hpp"
+#include "partitioned_slim.hpp"
+#include "reorder.hpp"
+#include "run_budget.hpp"
+#include "slim_driver.hpp"
+#include "slim_engine.hpp"
+#include "trace.hpp"
+
+
+namespace parametrization {
+
+namespace {
+
+bool check_uv(const ConstPoints &V, const ConstPoints &uv, const char *name = "uv")
+{
+    if (uv.rows() != V.rows() || uv.cols() != 2) {
+        std::cerr << "Error! " << name << " must be " << V.rows() << " x 2, not " << uv.rows() << " x " << uv.cols() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool check_options(const SlimOptions &options)
+{
+    if (options.engine != "slim" && options.engine != "newton" && options.engine != "slim+newton") {
+        std::cerr << "Unknown engine " << options.engine << ", use slim, newton or slim+newton" << std::endl;
+        return false;
+    }
+    if (options.init != "harmonic" && options.init != "conformal") {
+        std::cerr << "Unknown initialization " << options.init << ", use harmonic or conformal" << std::endl;
+        return false;
+    }
+    if (!options.reorder.empty() && options.reorder != "rcm" && options.reorder != "morton") {
+        std::cerr << "Unknown reordering " << options.reorder << ", use rcm or morton" << std::endl;
+        return false;
+    }
+    if (options.iterations < 0) {
+        std::cerr << "Error! Negative number of iterations" << std::endl;
+        return false;
+    }
+    // the partitioned solve has its own double precision engines and writes
+    // no checkpoints
+    if (options.partitions > 1) {
+        if (options.engine == "newton") {
+            std::cerr << "Error! Partitions need the slim engine" << std::endl;
+            return false;
+        }
+        if (options.single_precision) {
+            std::cerr << "Error! Single precision is not available with partitions" << std::endl;
+            return false;
+        }
+        if (options.resume) {
+            std::cerr << "Error! Partitioned runs write no checkpoint to resume from" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+Reordering solver_reordering(const ConstPoints &V, const ConstIndices &F, const std::string &reorder)
+{
+    Reordering reordering;
+    if (!reorder.empty()) reordering.compute(reorder, V, F);
+    return reordering;
+}
+
+// the mesh and the input uv in the order the solver works in: the caller's
+// arrays as they are, or permuted copies of them with a reordering
+struct SolverMesh {
+    SolverMesh(const ConstPoints &V_in, const ConstIndices &F_in, const ConstPoints &uv_in, const std::string &reorder)
+        : reordering(solver_reordering(V_in, F_in, reorder)),
+          V_reordered(reordering.active() ? reordering.reorder_vertices(V_in) : Eigen::MatrixXd()),
+          F_reordered(reordering.active() ? reordering.reorder_faces(F_in) : Eigen::MatrixXi()),
+          uv_reordered(reordering.active() ? reordering.reorder_vertices(uv_in) : Eigen::MatrixXd()),
+          V(reordering.active() ? ConstPoints(V_reordered) : V_in),
+          F(reordering.active() ? ConstIndices(F_reordered) : F_in),
+          uv(reordering.active() ? ConstPoints(uv_reordered) : uv_in)
+    {}
+    SolverMesh(const SolverMesh &) = delete;
+    SolverMesh &operator=(const SolverMesh &) = delete;
+
+    Reordering reordering;
+    Eigen::MatrixXd V_reordered;
+    Eigen::MatrixXi F_reordered;
+    Eigen::MatrixXd uv_reordered;
+    ConstPoints V;
+    ConstIndices F;
+    ConstPoints uv;
+};
+
+Eigen::MatrixXd boundary_uv(const ConstPoints &uv, const Eigen::VectorXi &bnd)
+{
+    Eigen::MatrixXd bnd_uv(bnd.size(), 2);
+    for (int i = 0; i < bnd.size(); i++) bnd_uv.row(i) = uv.row(bnd(i));
+    return bnd_uv;
+}
+
+// igl::map_vertices_to_circle on the boundary positions alone, so that the
+// whole mesh is not copied into its MatrixXd argument
+Eigen::MatrixXd circle_boundary(const ConstPoints &V, const Eigen::VectorXi &bnd)
+{
+    Eigen::MatrixXd V_bnd(bnd.size(), V.cols());
+    for (int i = 0; i < bnd.size(); i++) V_bnd.row(i) = V.row(bnd(i));
+    Eigen::MatrixXd bnd_uv;
+    igl::map_vertices_to_circle(V_bnd, Eigen::VectorXi::LinSpaced(bnd.size(), 0, (int)bnd.size() - 1), bnd_uv);
+    return bnd_uv;
+}
+
+} // namespace
+
+
+bool slim(const ConstPoints &V, const ConstIndices &F, Points uv, const SlimOptions &options, SlimResult &result)
+{
+    TRACE_SCOPE("slim");
+    MeshRequirements requirements;
+    requirements.boundary = true;
+    requirements.disk = options.fixed_boundary && options.circle_boundary; // the boundary is mapped to a circle
+    if (!check_options(options) || !check_uv(V, uv) || !check_mesh(V, F, requirements)) return false;
+
+    SolverMesh mesh(V, F, uv, options.reorder);
+    const ConstIndices &Fs = mesh.F;
+
+    // the fixed boundary is pinned, the free one is not
+    const double soft_const_p = options.fixed_boundary ? 1e35 : 0.0;
+    SlimCheckpoint ckpt;
+    const bool resumed = options.resume && !options.checkpoint.empty() &&
+        load_slim_checkpoint(options.checkpoint, mesh.V, Fs, igl::MappingEnergyType::SYMMETRIC_DIRICHLET,
+                             soft_const_p, mesh.reordering, ckpt);
+
+    Eigen::VectorXi bnd;
+    Eigen::MatrixXd bnd_uv;
+    {
+        TRACE_SCOPE("boundary");
+        igl::boundary_loop(Fs, bnd);
+        if (options.fixed_boundary && options.circle_boundary) {
+            bnd_uv = circle_boundary(mesh.V, bnd);
+        } else {
+            bnd_uv = boundary_uv(mesh.uv, bnd);
+        }
+    }
+
+    // per-mesh operators, shared by the initialization and the solvers;
+    // built on first use, since igl::slim and the float engine have their own
+    MeshOperators ops;
+    auto operators = [&]() -> MeshOperators & {
+        if (ops.num_vertices == 0) ops.compute(mesh.V, Fs);
+        return ops;
+    };
+    Eigen::MatrixXd uv_init;
+    if (resumed) {
+        std::cout << "Resume from iteration " << ckpt.iteration << std::endl;
+        uv_init = ckpt.V_o;
+        if (!options.fixed_boundary) bnd_uv = boundary_uv(uv_init, bnd);
+    } else if (!options.fixed_boundary && options.use_input) {
+        std::cout << "Use input parametrization as init" << std::endl;
+        uv_init = mesh.uv;
+    } else {
+        bool conformal = false;
+        if (!options.fixed_boundary && options.init == "conformal") {
+            conformal = conformal_init(mesh.V, Fs, bnd, operators(), uv_init);
+            if (conformal) {
+                std::cout << "Start from conformal param" << std::endl;
+                bnd_uv = boundary_uv(uv_init, bnd);
+            } else {
+                std::cerr << "Warning: conformal initialization flipped, using the harmonic one" << std::endl;
+            }
+        }
+        if (!conformal) {
+            TRACE_SCOPE("harmonic");
+            if (!options.fixed_boundary) bnd_uv = circle_boundary(mesh.V, bnd);
+            // laplacians are assembled once and reused by every harmonic solve
+            if (!harmonic_amg(operators().cotangent_laplacian(), bnd, bnd_uv, uv_init)) {
+                std::cerr << "Warning: harmonic initialization did not converge" << std::endl;
+            }
+            if (igl::flipped_triangles(uv_init, Fs).size() != 0) {
+                TRACE_SCOPE("harmonic_uniform");
+                harmonic_amg(operators().uniform_laplacian(), bnd, bnd_uv, uv_init); // use uniform laplacian
+            }
+        }
+    }
+    // the reordered input uv and the laplacians are not needed by the
+    // solver, nor are the operators unless the solver borrows them
+    mesh.uv_reordered.resize(0, 0);
+    const bool engine_operators = options.partitions <= 1 &&
+        (options.engine == "newton" || (!options.single_precision && !options.libigl));
+    if (engine_operators) {
+        ops.release_laplacians();
+    } else {
+        ops.clear();
+    }
+
+    const CheckpointTarget checkpoint(options.checkpoint, options.checkpoint_every, mesh.reordering);
+    const int first_iteration = resumed ? ckpt.iteration : 0;
+    Eigen::MatrixXd uv_solved;
+    double energy = 0.0;
+    int reached;
+    if (options.partitions > 1) {
+        // patches solved separately and stitched, see partitioned_slim.hpp
+        TRACE_SCOPE("solve");
+        reached = first_iteration + partitioned_slim(mesh.V, Fs, uv_init, bnd, bnd_uv, soft_const_p, options.partitions,
+                                                     options.iterations - first_iteration, uv_solved, energy);
+    } else if (options.engine == "newton") {
+        // projected Newton from the initialization, see newton_engine.hpp
+        TRACE_SCOPE("solve");
+        reached = run_newton(operators(), Fs, uv_init, bnd, bnd_uv, soft_const_p, first_iteration, options.iterations,
+                             checkpoint, uv_solved, energy);
+    } else if (options.single_precision) {
+        // float32 storage of the solver state, see slim_engine.hpp; the
+        // engine casts its own area and grad
+        TRACE_SCOPE("solve");
+        reached = run_slim_single_precision(mesh.V, Fs, uv_init, bnd, bnd_uv, soft_const_p, first_iteration,
+                                            options.iterations, checkpoint, uv_solved, energy);
+    } else if (!options.libigl) {
+        // boundary eliminated from the global system instead of a 1e35 penalty
+        TRACE_SCOPE("solve");
+        reached = run_slim_engine(operators(), Fs, uv_init, bnd, bnd_uv, soft_const_p, first_iteration,
+                                  options.iterations, checkpoint, uv_solved, energy);
+    } else {
+        igl::SLIMData data;
+        data.slim_energy = igl::MappingEnergyType::SYMMETRIC_DIRICHLET;
+        {
+            TRACE_SCOPE("precompute");
+            // SLIMData keeps copies of V and F of its own
+            igl::slim_precompute(mesh.V, Fs, uv_init, data, igl::MappingEnergyType::SYMMETRIC_DIRICHLET,
+                                 bnd, bnd_uv, soft_const_p);
+        }
+        std::cout << "energy = " << data.energy << std::endl;
+        trace::counter("energy_init", data.energy);
+        {
+            TRACE_SCOPE("solve");
+            reached = run_slim(data, first_iteration, options.iterations, checkpoint);
+        }
+        uv_solved = data.V_o;
+        energy = data.energy;
+    }
+
+    if (options.engine == "slim+newton" && !run_budget().stopped()) {
+        // SLIM slows down near the optimum, Newton converges quadratically there
+        TRACE_SCOPE("newton");
+        run_newton(operators(), Fs, uv_solved, bnd, bnd_uv, soft_const_p, 0, options.newton_iterations, CheckpointTarget(),
+                   uv_solved, energy);
+    }
+
+    std::cout << "energy = " << energy << std::endl;
+    trace::counter("energy", energy);
+    result.energy = energy;
+    result.flips = igl::flipped_triangles(uv_solved, Fs).size();
+    result.first_iteration = first_iteration;
+    result.iterations = reached;
+    uv = mesh.reordering.restore_vertices(uv_solved);
+    return true;
+}
+
+
+bool slim(const ConstPoints &V, const ConstIndices &F, Points uv, const SlimOptions &options,
+          double *energy, int *flips)
+{
+    SlimResult result;
+    if (!slim(V, F, uv, options, result)) return false;
+    if (energy != nullptr) *energy = result.energy;
+    if (flips != nullptr) *flips = result.flips;
+    return true;
+}
+
+
+bool slim_incremental(const ConstPoints &V, const ConstIndices &F,
+                      const ConstPoints &V_prev, const ConstIndices &F_prev, const ConstPoints &uv_prev,
+                      Points uv, const SlimOptions &options, int rings, double *energy)
+{
+    TRACE_SCOPE("slim");
+    MeshRequirements requirements;
+    requirements.boundary = true;
+    if (!check_options(options) || !check_uv(V, uv) || !check_mesh(V, F, requirements)) return false;
+    // the previous result only provides the uv of the vertices it shares
+    MeshRequirements previous_requirements;
+    previous_requirements.single_component = false;
+    previous_requirements.non_degenerate = false;
+    if (!check_uv(V_prev, uv_prev, "previous uv") || !check_mesh(V_prev, F_prev, previous_requirements, "Previous result")) {
+        return false;
+    }
+
+    SolverMesh mesh(V, F, uv, options.reorder);
+
+    // no boundary: free; no bnd_uv: pinned to the previous uv
+    Eigen::VectorXi bnd;
+    Eigen::MatrixXd bnd_uv;
+    if (options.fixed_boundary) {
+        igl::boundary_loop(mesh.F, bnd);
+        if (options.use_input) bnd_uv = boundary_uv(mesh.uv, bnd);
+    }
+
+    IncrementalResult inc;
+    if (!incremental_slim(mesh.V, mesh.F, V_prev, F_prev, uv_prev, bnd, bnd_uv, options.iterations, rings, inc)) {
+        return false;
+    }
+    std::cout << "energy = " << inc.energy << std::endl;
+    uv = mesh.reordering.restore_vertices(inc.uv);
+    if (energy != nullptr) *energy = inc.energy;
+    return true;
+}
+
+
+int slim_sequence(const ConstPoints &V, const ConstIndices &F, const ConstPoints &uv, const SlimOptions &options,
+                  int iterations, FrameSource next, FrameSink write)
+{
+    MeshRequirements requirements;
+    requirements.boundary = true;
+    if (!check_options(options) || !check_uv(V, uv) || !check_mesh(V, F, requirements)) return -1;
+
+    SolverMesh mesh(V, F, uv, options.reorder);
+    Eigen::VectorXi bnd;
+    igl::boundary_loop(mesh.F, bnd);
+    const Eigen::MatrixXd bnd_uv = boundary_uv(mesh.uv, bnd);
+    const double soft_const_p = options.fixed_boundary ? 1e35 : 0.0;
+
+    // frames of another size would be read out of bounds
+    const int nv = V.rows();
+    auto checked_next = [&next, nv](Eigen::MatrixXd &V_frame) {
+        if (!next(V_frame)) return false;
+        if (V_frame.rows() != nv || V_frame.cols() != 3) {
+            std::cerr << "Error! Frame has " << V_frame.rows() << " x " << V_frame.cols() << " positions, expected "
+                      << nv << " x 3" << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    // warm start every frame from the previous one, reusing the solver
+    if (options.engine == "newton") {
+        NewtonEngine solver;
+        solver.precompute(mesh.V, mesh.F, mesh.uv, bnd, bnd_uv, soft_const_p);
+        return solve_sequence(solver, checked_next, mesh.reordering, iterations, write);
+    }
+    SlimEngine<double> solver;
+    solver.precompute(mesh.V, mesh.F, mesh.uv, bnd, bnd_uv, soft_const_p);
+    return solve_sequence(solver, checked_next, mesh.reordering, iterations, write);
+}
+
+} // namespace parametrization
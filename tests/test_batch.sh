@@ -0,0 +1,79 @@
+#!/bin/sh
+# Several `batch run` workers drain one job directory. Every job must end in
+# done/ exactly once and run to completion exactly once, also the one whose
+# worker is killed while running it and which is requeued as stale.
+#
+#   sh tests/test_batch.sh path/to/batch [workers] [jobs]
+
+set -u
+batch=$1
+workers=${2:-4}
+count=${3:-20}
+jobs=$(mktemp -d)
+trap 'rm -rf "$jobs"' EXIT
+
+fail()
+{
+    echo "FAIL: $*"
+    "$batch" status "$jobs" --stale 2
+    exit 1
+}
+
+# flags a command does not declare are rejected before anything runs
+"$batch" run "$jobs" --max-job 1 > /dev/null 2>&1 && fail "an unknown option was accepted"
+
+# the first attempt of "slow" hangs until its worker is killed, the retry
+# finishes; every completed run appends the job name to runs
+"$batch" submit "$jobs" slow sh -c 'if [ -e slow.pid ]; then echo slow >> runs; else echo $$ > slow.pid; sleep 600; fi' || fail "submit"
+"$batch" run "$jobs" --worker doomed --max-jobs 1 --heartbeat 0.5 --stale 2 > "$jobs/doomed.out" 2>&1 &
+doomed=$!
+tries=0
+while [ ! -s "$jobs/slow.pid" ]; do
+    tries=$((tries + 1))
+    [ $tries -gt 100 ] && fail "the first worker did not start slow"
+    sleep 0.1
+done
+# the job runs in its own process group
+kill -9 "$doomed"
+kill -9 -- "-$(cat "$jobs/slow.pid")" 2> /dev/null
+wait "$doomed" 2> /dev/null
+[ -e "$jobs/claimed/slow.job@doomed" ] || fail "the killed worker left no claim"
+
+i=0
+while [ $i -lt $count ]; do
+    "$batch" submit "$jobs" "job$i" sh -c "sleep 0.05; echo job$i >> runs" || fail "submit job$i"
+    i=$((i + 1))
+done
+
+# a submit in progress, under the old temporary name and the hidden one: not
+# jobs, never claimed
+printf 'echo partial >> runs\n' > "$jobs/queue/partial.job.tmp.99999"
+printf 'echo partial >> runs\n' > "$jobs/queue/.partial.job.tmp.99999"
+
+pids=""
+w=0
+while [ $w -lt "$workers" ]; do
+    "$batch" run "$jobs" --worker "w$w" --heartbeat 0.5 --stale 2 --wait > "$jobs/w$w.out" 2>&1 &
+    pids="$pids $!"
+    w=$((w + 1))
+done
+for pid in $pids; do
+    wait "$pid" || fail "a worker failed"
+done
+
+total=$((count + 1))
+[ -e "$jobs/queue/partial.job.tmp.99999" ] && [ -e "$jobs/queue/.partial.job.tmp.99999" ] ||
+    fail "a temporary file was taken for a job"
+rm -f "$jobs/queue/partial.job.tmp.99999" "$jobs/queue/.partial.job.tmp.99999"
+[ -z "$(ls -A "$jobs/queue")" ] || fail "jobs left in the queue"
+[ -z "$(ls "$jobs/claimed")" ] || fail "jobs left claimed"
+[ -z "$(ls "$jobs/failed")" ] || fail "failed jobs"
+[ "$(ls "$jobs/done" | wc -l)" -eq $total ] || fail "$(ls "$jobs/done" | wc -l) of $total jobs done"
+for job in "$jobs"/done/*.job; do
+    [ "$(grep -c '^# exit 0 ' "$job")" -eq 1 ] || fail "$(basename "$job") recorded $(grep -c '^# exit' "$job") times"
+done
+[ "$(wc -l < "$jobs/runs")" -eq $total ] || fail "$(wc -l < "$jobs/runs") runs for $total jobs"
+[ -z "$(sort "$jobs/runs" | uniq -d)" ] || fail "jobs run twice: $(sort "$jobs/runs" | uniq -d)"
+grep -q "requeued slow.job" "$jobs"/w*.out || fail "slow was not requeued"
+
+echo "$total jobs done once by $workers workers"
@@ -0,0 +1,59 @@
+#pragma once
+
+// Minimal checks shared by the tests: every test is an executable that
+// returns non zero if a CHECK failed.
+
+#include <Eigen/Core>
+
+#include <cmath>
+#include <cstdio>
+
+
+static int test_failures = 0;
+
+#define CHECK(condition)                                                             \
+    do {                                                                             \
+        if (!(condition)) {                                                          \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                         \
+        }                                                                            \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tolerance)                                                  \
+    do {                                                                             \
+        double check_a = (a), check_b = (b);                                         \
+        if (!(std::abs(check_a - check_b) <= (tolerance))) {                         \
+            fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s = %.17g, %s = %.17g\n",    \
+                    __FILE__, __LINE__, #a, check_a, #b, check_b);                   \
+            test_failures++;                                                         \
+        }                                                                            \
+    } while (0)
+
+inline int test_result(const char *name)
+{
+    if (test_failures == 0) printf("%s: passed\n", name);
+    else printf("%s: %d checks failed\n", name, test_failures);
+    return test_failures == 0 ? 0 : 1;
+}
+
+// n x n vertex grid on [0, 1] x [0, height], z = bump * sin(3x) cos(2y),
+// two counter clockwise triangles per cell
+inline void grid_mesh(int n, Eigen::MatrixXd &V, Eigen::MatrixXi &F, double bump = 0.0, double height = 1.0)
+{
+    V.resize(n * n, 3);
+    F.resize(2 * (n - 1) * (n - 1), 3);
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            double x = i / (n - 1.0), y = height * j / (n - 1.0);
+            V.row(j * n + i) << x, y, bump * std::sin(3.0 * x) * std::cos(2.0 * y);
+        }
+    }
+    int f = 0;
+    for (int j = 0; j < n - 1; j++) {
+        for (int i = 0; i < n - 1; i++) {
+            int a = j * n + i, b = a + 1, c = a + n, d = c + 1;
+            F.row(f++) << a, b, d;
+            F.row(f++) << a, d, c;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+// CsrAssembly against the same face blocks assembled from triplets.
+
+#include <Eigen/Sparse>
+
+#include <random>
+#include <vector>
+
+#include "csr_assembly.hpp"
+#include "test_common.hpp"
+
+
+// assembles one random k x k block per face through the scatter map and
+// through triplets, and compares the two matrices
+static void check_assembly(const Eigen::MatrixXi &F, int blocks, int nv, const std::vector<int> &dofs, int size)
+{
+    CsrAssembly assembly;
+    assembly.build(F, blocks, nv, size, [&](int b, int v) { return dofs[b * nv + v]; });
+    const int k = 3 * blocks;
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::vector<Eigen::MatrixXd> block(F.rows());
+    for (auto &B : block) {
+        B.resize(k, k);
+        for (int i = 0; i < k * k; i++) B(i) = uniform(random);
+    }
+
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (int i = 0; i < size; i++) triplets.emplace_back(i, i, 1.0);
+    for (int f = 0; f < F.rows(); f++) {
+        for (int c = 0; c < k; c++) {
+            for (int r = 0; r < k; r++) {
+                int row = dofs[(r / 3) * nv + F(f, r % 3)], col = dofs[(c / 3) * nv + F(f, c % 3)];
+                bool present = row >= 0 && col >= 0;
+                CHECK((assembly.slot(F, f, r, c) >= 0) == present);
+                if (present) triplets.emplace_back(row, col, block[f](r, c));
+            }
+        }
+    }
+    Eigen::SparseMatrix<double> reference(size, size);
+    reference.setFromTriplets(triplets.begin(), triplets.end());
+
+    assembly.set_zero();
+    double *values = assembly.values();
+    for (int i = 0; i < size; i++) values[assembly.diagonal(i)] += 1.0;
+    assembly.for_each_face([&](int f) {
+        for (int c = 0; c < k; c++) {
+            for (int r = 0; r < k; r++) {
+                int slot = assembly.slot(F, f, r, c);
+                if (slot >= 0) values[slot] += block[f](r, c);
+            }
+        }
+    });
+    const Eigen::SparseMatrix<double> &A = assembly.matrix();
+
+    // same pattern (the reference has no explicit zeros) and same values
+    CHECK(A.nonZeros() == reference.nonZeros());
+    CHECK((Eigen::MatrixXd(A) - Eigen::MatrixXd(reference)).cwiseAbs().maxCoeff() < 1e-12);
+    for (int col = 0; col < A.outerSize(); col++) {
+        for (int p = A.outerIndexPtr()[col]; p + 1 < A.outerIndexPtr()[col + 1]; p++) {
+            CHECK(A.innerIndexPtr()[p] < A.innerIndexPtr()[p + 1]);
+        }
+    }
+}
+
+int main()
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    grid_mesh(9, V, F);
+    const int n = V.rows();
+
+    // one unknown per vertex, like the laplacians
+    std::vector<int> scalar(n);
+    for (int v = 0; v < n; v++) scalar[v] = v;
+    check_assembly(F, 1, n, scalar, n);
+
+    // u and v of every vertex, like the Newton hessian
+    std::vector<int> uv(2 * n);
+    for (int d = 0; d < 2 * n; d++) uv[d] = d;
+    check_assembly(F, 2, n, uv, 2 * n);
+
+    // pinned border vertices eliminated, like SLIM with hard constraints
+    std::vector<int> free_index(2 * n);
+    int num_free = 0;
+    for (int b = 0; b < 2; b++) {
+        for (int v = 0; v < n; v++) {
+            int i = v % 9, j = v / 9;
+            bool border = i == 0 || j == 0 || i == 8 || j == 8;
+            free_index[b * n + v] = border ? -1 : num_free++;
+        }
+    }
+    check_assembly(F, 2, n, free_index, num_free);
+
+    return test_result("csr_assembly");
+}
@@ -0,0 +1,67 @@
+// compute_distortion on maps whose distortion is known exactly.
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <cmath>
+
+#include "distortion.hpp"
+#include "test_common.hpp"
+
+
+int main()
+{
+    Eigen::MatrixXd grid;
+    Eigen::MatrixXi F;
+    grid_mesh(12, grid, F, 0.0, 0.7);
+    const int nf = F.rows();
+
+    // a flat grid placed in 3D by a rotation and a translation, and its uv
+    // an in-plane rotation of the grid: the map is an isometry
+    const Eigen::Matrix3d R = (Eigen::AngleAxisd(0.7, Eigen::Vector3d(1.0, 2.0, 3.0).normalized())).toRotationMatrix();
+    Eigen::MatrixXd V = (grid * R.transpose()).rowwise() + Eigen::RowVector3d(0.3, -1.0, 2.0);
+    const Eigen::Matrix2d rotation = Eigen::Rotation2Dd(-1.1).toRotationMatrix();
+    Eigen::MatrixXd uv = (grid.leftCols(2) * rotation.transpose()).rowwise() + Eigen::RowVector2d(5.0, -2.0);
+
+    DistortionStats iso = compute_distortion(V, F, uv, true);
+    CHECK(iso.num_faces == nf);
+    CHECK(iso.flips == 0);
+    CHECK(iso.degenerate == 0);
+    CHECK(!iso.mirrored);
+    CHECK_NEAR(iso.area_3d, 0.7, 1e-12);
+    CHECK_NEAR(iso.area_uv, 0.7, 1e-12);
+    CHECK_NEAR(iso.symmetric_dirichlet, 4.0, 1e-9);
+    CHECK_NEAR(iso.symmetric_dirichlet_max, 4.0, 1e-9);
+    CHECK_NEAR(iso.conformal_mean, 1.0, 1e-9);
+    CHECK_NEAR(iso.conformal_max, 1.0, 1e-9);
+    CHECK_NEAR(iso.area_mean, 1.0, 1e-9);
+    CHECK_NEAR(iso.area_max, 1.0, 1e-9);
+    CHECK(iso.conformal_hist[0] == nf && iso.area_hist[0] == nf);
+    CHECK(iso.singular_values.rows() == nf);
+    CHECK_NEAR((iso.singular_values.array() - 1.0).abs().maxCoeff(), 0.0, 1e-9);
+
+    // mirrored uvs: the majority orientation is negative, still no flips
+    Eigen::MatrixXd mirrored = uv;
+    mirrored.col(0) *= -1.0;
+    DistortionStats mirror = compute_distortion(V, F, mirrored);
+    CHECK(mirror.mirrored);
+    CHECK(mirror.flips == 0);
+    CHECK_NEAR(mirror.symmetric_dirichlet, 4.0, 1e-9);
+
+    // uniform scaling by 2: conformal, and area preserving after rescaling
+    DistortionStats scaled = compute_distortion(V, F, 2.0 * uv);
+    CHECK(scaled.flips == 0);
+    CHECK_NEAR(scaled.symmetric_dirichlet, 2.0 * (4.0 + 0.25), 1e-9);
+    CHECK_NEAR(scaled.conformal_max, 1.0, 1e-9);
+    CHECK_NEAR(scaled.area_max, 1.0, 1e-9);
+
+    // one face turned over is a flip and is left out of the averages
+    Eigen::MatrixXi F_flip = F;
+    std::swap(F_flip(5, 1), F_flip(5, 2));
+    DistortionStats flipped = compute_distortion(V, F_flip, uv, F_flip);
+    CHECK(flipped.flips == 1);
+    CHECK(flipped.degenerate == 0);
+    CHECK_NEAR(flipped.symmetric_dirichlet, 4.0, 1e-9);
+
+    return test_result("distortion");
+}
@@ -0,0 +1,140 @@
+// Newton engine derivatives against finite differences: the gradient and
+// hessian of the symmetric Dirichlet density per jacobian, and the gradient
+// and hessian assembled over a mesh against the engine energy.
+
+#include <Eigen/Core>
+#include <Eigen/Eigenvalues>
+
+#include <cmath>
+#include <random>
+
+#include "newton_engine.hpp"
+#include "test_common.hpp"
+
+
+// exposes the assembly of the projected system
+class TestEngine : public NewtonEngine {
+public:
+    Eigen::VectorXd x() const { return iterate_as_double(); }
+    double energy_at(const Eigen::VectorXd &x) const { return compute_energy(x); }
+    void gradient_hessian(const Eigen::VectorXd &x, Eigen::VectorXd &g, Eigen::MatrixXd &H)
+    {
+        hessian.build(F, 2, n, 2 * n, [this](int b, int v) { return b * n + v; });
+        assemble(x, g);
+        H = Eigen::MatrixXd(hessian.matrix());
+    }
+};
+
+static double density(const Eigen::Vector4d &j)
+{
+    Eigen::Matrix2d J;
+    J << j(0), j(1), j(2), j(3);
+    Eigen::Vector4d g;
+    Eigen::Matrix4d H;
+    return symmetric_dirichlet_hessian(J, g, H);
+}
+
+static void check_density(const Eigen::Matrix2d &J)
+{
+    Eigen::Vector4d g;
+    Eigen::Matrix4d H;
+    const double value = symmetric_dirichlet_hessian(J, g, H);
+    CHECK_NEAR(value, J.squaredNorm() + J.inverse().squaredNorm(), 1e-10 * value);
+
+    const Eigen::Vector4d j(J(0, 0), J(0, 1), J(1, 0), J(1, 1));
+    const double h = 1e-6;
+    Eigen::Vector4d g_fd;
+    Eigen::Matrix4d H_fd;
+    for (int k = 0; k < 4; k++) {
+        Eigen::Vector4d e = Eigen::Vector4d::Zero();
+        e(k) = h;
+        g_fd(k) = (density(j + e) - density(j - e)) / (2.0 * h);
+
+        Eigen::Matrix2d Jp, Jm;
+        Jp << j(0) + e(0), j(1) + e(1), j(2) + e(2), j(3) + e(3);
+        Jm << j(0) - e(0), j(1) - e(1), j(2) - e(2), j(3) - e(3);
+        Eigen::Vector4d gp, gm;
+        Eigen::Matrix4d unused;
+        symmetric_dirichlet_hessian(Jp, gp, unused);
+        symmetric_dirichlet_hessian(Jm, gm, unused);
+        H_fd.col(k) = (gp - gm) / (2.0 * h);
+    }
+    CHECK_NEAR((g - g_fd).norm(), 0.0, 1e-6 * g.norm() + 1e-8);
+    CHECK_NEAR((H - H_fd).norm(), 0.0, 1e-5 * H.norm());
+    CHECK_NEAR((H - H.transpose()).norm(), 0.0, 1e-12 * H.norm());
+
+    // projection: positive semidefinite, unchanged if already so
+    Eigen::Matrix4d P = project_psd(H);
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> eig(P);
+    CHECK(eig.eigenvalues().minCoeff() >= -1e-10 * H.norm());
+    if (Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d>(H).eigenvalues().minCoeff() >= 0.0) {
+        CHECK_NEAR((P - H).norm(), 0.0, 1e-10 * H.norm());
+    }
+}
+
+// no constraints, so the gradient is the plain energy gradient; the
+// assembled hessian is compared with the finite difference of the gradient
+// only if no face hessian is clamped
+static void check_mesh(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, const Eigen::MatrixXd &uv, bool exact_hessian)
+{
+    TestEngine engine;
+    engine.precompute(V, F, uv, Eigen::VectorXi(), Eigen::MatrixXd(0, 2), 0.0);
+    const Eigen::VectorXd x = engine.x();
+    CHECK(std::isfinite(engine.energy_at(x)));
+
+    Eigen::VectorXd g;
+    Eigen::MatrixXd H;
+    engine.gradient_hessian(x, g, H);
+    const double h = 1e-6;
+    Eigen::VectorXd g_fd(x.size());
+    Eigen::MatrixXd H_fd(x.size(), x.size());
+    for (int d = 0; d < x.size(); d++) {
+        Eigen::VectorXd xp = x, xm = x, gp, gm;
+        Eigen::MatrixXd unused;
+        xp(d) += h;
+        xm(d) -= h;
+        g_fd(d) = (engine.energy_at(xp) - engine.energy_at(xm)) / (2.0 * h);
+        engine.gradient_hessian(xp, gp, unused);
+        engine.gradient_hessian(xm, gm, unused);
+        H_fd.col(d) = (gp - gm) / (2.0 * h);
+    }
+    CHECK_NEAR((g - g_fd).norm(), 0.0, 1e-6 * g.norm());
+
+    // symmetric positive semidefinite either way
+    CHECK_NEAR((H - H.transpose()).norm(), 0.0, 1e-12 * H.norm());
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(H);
+    CHECK(eig.eigenvalues().minCoeff() >= -1e-9 * H.norm());
+    if (exact_hessian) CHECK_NEAR((H - H_fd).norm(), 0.0, 1e-5 * H.norm());
+}
+
+int main()
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+    // identity, a rotation, and random orientation preserving jacobians,
+    // some far from isometric where the projection clamps
+    check_density(Eigen::Matrix2d::Identity());
+    check_density(Eigen::Rotation2Dd(0.4).toRotationMatrix());
+    for (int t = 0; t < 20; t++) {
+        Eigen::Matrix2d J;
+        J << uniform(random), uniform(random), uniform(random), uniform(random);
+        if (J.determinant() < 0.0) J.row(0) *= -1.0;
+        if (J.determinant() < 1e-2) J += 0.5 * Eigen::Matrix2d::Identity();
+        if (J.determinant() <= 0.0) continue;
+        check_density(J);
+    }
+
+    // a bumpy grid with a perturbed flat uv, no flips, and the same uv
+    // stretched by 1.5, where every face hessian is positive definite and the
+    // projection leaves it alone
+    Eigen::MatrixXd V, uv;
+    Eigen::MatrixXi F;
+    grid_mesh(6, V, F, 0.2);
+    uv = V.leftCols(2);
+    for (int i = 0; i < uv.rows(); i++) uv.row(i) += 0.02 * Eigen::RowVector2d(uniform(random), uniform(random));
+    check_mesh(V, F, uv, false);
+    check_mesh(V, F, 1.5 * uv, true);
+
+    return test_result("newton_hessian");
+}
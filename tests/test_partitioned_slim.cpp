@@ -0,0 +1,103 @@
+// partitioned_slim on a bumpy grid: the map stays flip free and its energy
+// goes down, and the peak memory does not grow with the number of patches,
+// since a patch engine only lives while its patch is solved. It stays close
+// to the peak of the global correction alone, which is linear in the mesh
+// size. Every run is a child process, so its peak resident size is its own.
+
+#include <Eigen/Core>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "distortion.hpp"
+#include "partitioned_slim.hpp"
+#include "test_common.hpp"
+
+
+static const int n = 140;
+
+// peak resident size in kB of a run with `parts` patches, or of one global
+// correction iteration without patches if parts is 0; -1 if it failed
+static long run(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F, const Eigen::MatrixXd &uv_init,
+                const Eigen::VectorXi &b, const Eigen::MatrixXd &bc, int parts)
+{
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        // the solver output is not part of the test; at most two patches
+        // are solved at a time
+        if (freopen("/dev/null", "w", stdout) == nullptr) _exit(2);
+#ifdef _OPENMP
+        omp_set_num_threads(std::min(omp_get_max_threads(), 2));
+#endif
+        if (parts == 0) {
+            SlimEngine<double> global;
+            global.iterative = true;
+            global.precompute(V, F, uv_init, b, bc, 1e35);
+            _exit(global.iterate() ? 0 : 1);
+        }
+        Eigen::MatrixXd uv;
+        double energy = 0.0;
+        const int reached = partitioned_slim(V, F, uv_init, b, bc, 1e35, parts, 10, uv, energy);
+        DistortionStats init = compute_distortion(V, F, uv_init), stats = compute_distortion(V, F, uv);
+        const bool ok = reached == 10 && stats.flips == 0 && std::isfinite(energy) &&
+                        stats.symmetric_dirichlet < init.symmetric_dirichlet;
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    struct rusage usage;
+    if (pid < 0 || wait4(pid, &status, 0, &usage) != pid) return -1;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+    return usage.ru_maxrss;
+}
+
+int main()
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    grid_mesh(n, V, F, 0.3);
+
+    // the grid squeezed towards one corner, the border pinned where it is
+    Eigen::MatrixXd uv_init(V.rows(), 2);
+    for (int i = 0; i < V.rows(); i++) uv_init.row(i) << V(i, 0) * V(i, 0), V(i, 1) * std::sqrt(V(i, 1));
+    std::vector<int> border;
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            if (i == 0 || j == 0 || i == n - 1 || j == n - 1) border.push_back(j * n + i);
+        }
+    }
+    Eigen::VectorXi b(border.size());
+    Eigen::MatrixXd bc(border.size(), 2);
+    for (int k = 0; k < b.size(); k++) {
+        b(k) = border[k];
+        bc.row(k) = uv_init.row(border[k]);
+    }
+
+    const long global = run(V, F, uv_init, b, bc, 0);
+    const long few = run(V, F, uv_init, b, bc, 4);
+    const long many = run(V, F, uv_init, b, bc, 32);
+    printf("peak resident size: %ld kB for the global correction, %ld kB with 4 patches, %ld kB with 32\n",
+           global, few, many);
+    CHECK(global > 0);
+    CHECK(few > 0);
+    CHECK(many > 0);
+    // more, smaller patches: no more memory than a few large ones, and the
+    // patch engines add little to the global state; keeping all of them
+    // alive for the whole run added about half of it
+    CHECK(many <= few + few / 20);
+    CHECK(many <= global + global / 5);
+
+    return test_result("partitioned_slim");
+}
@@ -0,0 +1,113 @@
+// writePUV / readPUV round trip: uvs within half a quantization step,
+// positions rounded to float, faces exact; damaged files are rejected.
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "puv_output.hpp"
+#include "test_common.hpp"
+
+
+static const char *path = "test_puv.puv";
+
+static void check_round_trip(const Eigen::MatrixXd &V, const Eigen::MatrixXi &F,
+                             const Eigen::MatrixXd &TC, const Eigen::MatrixXi &FTC, int bits)
+{
+    double error = -1.0;
+    CHECK(writePUV(path, V, F, TC, FTC, bits, &error));
+
+    Eigen::MatrixXd V_read, TC_read;
+    Eigen::MatrixXi F_read, FTC_read;
+    CHECK(readPUV(path, V_read, F_read, TC_read, FTC_read));
+    CHECK(V_read.rows() == V.rows() && TC_read.rows() == TC.rows());
+    CHECK(F_read == F && FTC_read == FTC);
+    if (V_read.rows() != V.rows() || TC_read.rows() != TC.rows()) return;
+
+    for (int i = 0; i < V.rows(); i++) {
+        for (int j = 0; j < 3; j++) CHECK(V_read(i, j) == (double)(float)V(i, j));
+    }
+    // per axis within half its step; the reported error is the largest
+    const double levels = std::ldexp(1.0, bits) - 1.0;
+    double largest_step = 0.0, worst = 0.0;
+    for (int k = 0; k < 2; k++) {
+        const double step = (TC.col(k).maxCoeff() - TC.col(k).minCoeff()) / levels;
+        const double axis_error = (TC_read.col(k) - TC.col(k)).cwiseAbs().maxCoeff();
+        CHECK(axis_error <= 0.5 * step * (1.0 + 1e-9));
+        largest_step = std::max(largest_step, step);
+        worst = std::max(worst, axis_error);
+    }
+    CHECK(error >= 0.0 && error <= 0.5 * largest_step * (1.0 + 1e-9));
+    CHECK_NEAR(error, worst, 1e-9 * largest_step);
+}
+
+// rewrites the file with `cut_bytes` cut off its end, or a header count changed
+static void damage(int cut_bytes, int header_field, std::uint32_t value)
+{
+    FILE *in = fopen(path, "rb");
+    std::vector<char> data;
+    for (int c; (c = fgetc(in)) != EOF;) data.push_back((char)c);
+    fclose(in);
+    data.resize(data.size() - cut_bytes);
+    if (header_field >= 0) std::memcpy(&data[4 + 4 * header_field], &value, sizeof(value));
+    FILE *out = fopen(path, "wb");
+    fwrite(data.data(), 1, data.size(), out);
+    fclose(out);
+}
+
+int main()
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    grid_mesh(17, V, F, 0.3);
+
+    std::mt19937 random(11);
+    std::uniform_real_distribution<double> u(-0.3, 1.7), v(2.0, 2.5);
+    Eigen::MatrixXd uv(V.rows(), 2);
+    for (int i = 0; i < uv.rows(); i++) uv.row(i) << u(random), v(random);
+
+    // per vertex uvs, every uv width
+    for (int bits : {1, 8, 12, 16, 17, 24, 32}) check_round_trip(V, F, uv, F, bits);
+
+    // per corner uvs with their own faces
+    Eigen::MatrixXd TC(3 * F.rows(), 2);
+    Eigen::MatrixXi FTC(F.rows(), 3);
+    for (int f = 0; f < F.rows(); f++) {
+        for (int c = 0; c < 3; c++) {
+            FTC(f, c) = 3 * f + c;
+            TC.row(3 * f + c) = uv.row(F(f, c)) + Eigen::RowVector2d(0.01 * c, -0.02 * c);
+        }
+    }
+    for (int bits : {10, 16, 20}) check_round_trip(V, F, TC, FTC, bits);
+
+    Eigen::MatrixXd V_read, TC_read;
+    Eigen::MatrixXi F_read, FTC_read;
+
+    // truncated
+    CHECK(writePUV(path, V, F, uv, F, 16));
+    damage(1, -1, 0);
+    CHECK(!readPUV(path, V_read, F_read, TC_read, FTC_read));
+
+    // counts that do not match the file, rejected before allocating them
+    for (int field = 0; field < 3; field++) {
+        CHECK(writePUV(path, V, F, uv, F, 16));
+        damage(0, field, 0xffffffffu);
+        CHECK(!readPUV(path, V_read, F_read, TC_read, FTC_read));
+    }
+
+    // a face past the vertices
+    Eigen::MatrixXi F_bad = F;
+    F_bad(3, 1) = V.rows();
+    CHECK(writePUV(path, V, F_bad, uv, F_bad, 16));
+    CHECK(!readPUV(path, V_read, F_read, TC_read, FTC_read));
+
+    remove(path);
+    return test_result("puv");
+}
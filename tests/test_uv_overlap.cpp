@@ -0,0 +1,89 @@
+// find_uv_overlaps on a chart folded over itself without any flipped face,
+// against all pairs tested directly, and triangles_overlap on touching and
+// collapsed triangles.
+
+#include <Eigen/Core>
+
+#include <cmath>
+#include <vector>
+
+#include "test_common.hpp"
+#include "uv_overlap.hpp"
+
+
+// the grid wound around an annulus by `turn` radians; past 2 pi the strip
+// lies on its own start, every face keeps its orientation
+static Eigen::MatrixXd wound_strip(const Eigen::MatrixXd &grid, double turn)
+{
+    Eigen::MatrixXd uv(grid.rows(), 2);
+    for (int i = 0; i < grid.rows(); i++) {
+        double angle = turn * grid(i, 0), radius = 1.0 + 0.5 * grid(i, 1);
+        uv.row(i) << radius * std::cos(angle), radius * std::sin(angle);
+    }
+    return uv;
+}
+
+static long long brute_force_pairs(const Eigen::MatrixXd &uv, const Eigen::MatrixXi &F, double eps)
+{
+    long long pairs = 0;
+    for (int f = 0; f < F.rows(); f++) {
+        Eigen::Vector2d a[3];
+        for (int i = 0; i < 3; i++) a[i] = uv.row(F(f, i)).transpose();
+        for (int g = f + 1; g < F.rows(); g++) {
+            Eigen::Vector2d b[3];
+            for (int i = 0; i < 3; i++) b[i] = uv.row(F(g, i)).transpose();
+            pairs += overlap::triangles_overlap(a, b, eps);
+        }
+    }
+    return pairs;
+}
+
+int main()
+{
+    Eigen::MatrixXd grid;
+    Eigen::MatrixXi F;
+    grid_mesh(40, grid, F, 0.0, 0.2);
+    const double pi = std::acos(-1.0);
+
+    // open strip: neighbours touch, nothing overlaps
+    OverlapResult open = find_uv_overlaps(wound_strip(grid, 1.5 * pi), F);
+    CHECK(open.pairs == 0);
+    CHECK(open.faces.empty());
+
+    // 2.5 pi: the last fifth of the strip covers the first fifth
+    const Eigen::MatrixXd uv = wound_strip(grid, 2.5 * pi);
+    OverlapResult folded = find_uv_overlaps(uv, F);
+    CHECK(folded.pairs > 0);
+    CHECK(folded.pairs == brute_force_pairs(uv, F, 1e-9 * 2.0 * pi / 39.0));
+    std::vector<bool> involved(F.rows(), false);
+    for (std::size_t i = 0; i < folded.faces.size(); i++) {
+        if (i > 0) CHECK(folded.faces[i - 1] < folded.faces[i]);
+        involved[folded.faces[i]] = true;
+    }
+    for (int f = 0; f < F.rows(); f++) {
+        // the strip parameter of the face, 0 to 1 along the winding
+        double s = (grid(F(f, 0), 0) + grid(F(f, 1), 0) + grid(F(f, 2), 0)) / 3.0;
+        // s < 0.2 and s > 0.8 cover each other, faces at the ends of the
+        // covered part may only touch
+        if (s < 0.18 || s > 0.82) CHECK(involved[f]);
+        if (s > 0.22 && s < 0.78) CHECK(!involved[f]);
+    }
+
+    // shared edge and shared corner only touch
+    Eigen::Vector2d a[3] = { {0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0} };
+    Eigen::Vector2d edge[3] = { {1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0} };
+    Eigen::Vector2d corner[3] = { {1.0, 0.0}, {2.0, 0.0}, {1.5, 1.0} };
+    CHECK(!overlap::triangles_overlap(a, edge, 1e-12));
+    CHECK(!overlap::triangles_overlap(a, corner, 1e-12));
+    Eigen::Vector2d inside[3] = { {0.1, 0.1}, {0.3, 0.1}, {0.1, 0.3} };
+    CHECK(overlap::triangles_overlap(a, inside, 1e-12));
+
+    // a face collapsed to a segment across a, and one beside it
+    Eigen::Vector2d crossing[3] = { {-1.0, 0.2}, {-1.0, 0.2}, {2.0, 0.3} };
+    Eigen::Vector2d beside[3] = { {-1.0, 2.0}, {-1.0, 2.0}, {2.0, 2.0} };
+    CHECK(overlap::triangles_overlap(a, crossing, 1e-12));
+    CHECK(overlap::triangles_overlap(crossing, a, 1e-12));
+    CHECK(!overlap::triangles_overlap(a, beside, 1e-12));
+
+    return test_result("uv_overlap");
+}